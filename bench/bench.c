@@ -0,0 +1,91 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./bench.h"
+
+int measure_init(Measure *measure, const char *name, size_t capacity)
+{
+    trace_assert(measure);
+    trace_assert(name);
+
+    measure->name = name;
+    measure->samples = nth_calloc(capacity, sizeof(Uint64));
+    if (measure->samples == NULL) {
+        return -1;
+    }
+    measure->samples_count = 0;
+    measure->samples_capacity = capacity;
+    measure->allocations = 0;
+
+    return 0;
+}
+
+void measure_free(Measure *measure)
+{
+    trace_assert(measure);
+    free(measure->samples);
+    measure->samples = NULL;
+}
+
+void measure_begin(Measure *measure)
+{
+    trace_assert(measure);
+    measure->begin_allocations = nth_alloc_count();
+    measure->begin_counter = SDL_GetPerformanceCounter();
+}
+
+void measure_end(Measure *measure)
+{
+    const Uint64 end_counter = SDL_GetPerformanceCounter();
+
+    trace_assert(measure);
+    trace_assert(measure->samples_count < measure->samples_capacity);
+
+    measure->samples[measure->samples_count++] = end_counter - measure->begin_counter;
+    measure->allocations += nth_alloc_count() - measure->begin_allocations;
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    const Uint64 sa = *(const Uint64 *) a;
+    const Uint64 sb = *(const Uint64 *) b;
+    return (sa > sb) - (sa < sb);
+}
+
+static double measure_percentile_us(const Measure *measure, size_t percent)
+{
+    trace_assert(measure);
+    trace_assert(measure->samples_count > 0);
+
+    const size_t index = (measure->samples_count - 1) * percent / 100;
+    return (double) measure->samples[index] * 1e6 / (double) SDL_GetPerformanceFrequency();
+}
+
+void measure_report_header(FILE *stream)
+{
+    fprintf(stream, "scenario\tmeasure\tticks\tmedian_us\tp99_us\tallocations\n");
+}
+
+void measure_report(Measure *measure, const char *scenario, FILE *stream)
+{
+    trace_assert(measure);
+    trace_assert(scenario);
+
+    if (measure->samples_count == 0) {
+        return;
+    }
+
+    qsort(measure->samples, measure->samples_count, sizeof(Uint64), compare_samples);
+
+    fprintf(stream, "%s\t%s\t%lu\t%.3f\t%.3f\t%lu\n",
+            scenario,
+            measure->name,
+            (unsigned long) measure->samples_count,
+            measure_percentile_us(measure, 50),
+            measure_percentile_us(measure, 99),
+            (unsigned long) measure->allocations);
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <SDL.h>
+#include <stdio.h>
+
+// Timings of a single piece of code, one sample per tick
+typedef struct {
+    const char *name;
+    Uint64 *samples;
+    size_t samples_count;
+    size_t samples_capacity;
+    size_t allocations;
+
+    Uint64 begin_counter;
+    size_t begin_allocations;
+} Measure;
+
+int measure_init(Measure *measure, const char *name, size_t capacity);
+void measure_free(Measure *measure);
+
+void measure_begin(Measure *measure);
+void measure_end(Measure *measure);
+
+// One tab separated line per measure, so the reports of two commits
+// can be compared line by line
+void measure_report_header(FILE *stream);
+void measure_report(Measure *measure, const char *scenario, FILE *stream);
+
+#endif  // BENCH_H_
@@ -0,0 +1,417 @@
+#include <SDL.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "synthetic_levels.h"
+#include "color.h"
+#include "game.h"
+#include "game/camera.h"
+#include "game/sprite_font.h"
+#include "game/level/boxes.h"
+#include "game/level/lava.h"
+#include "game/level/platforms.h"
+#include "game/level/rigid_bodies.h"
+#include "game/level/level_editor/rect_layer.h"
+#include "game/level/level_editor/player_layer.h"
+#include "math/point.h"
+#include "math/rand.h"
+#include "math/rect.h"
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "game/level/level_editor.h"
+
+#define BENCH_LEVEL_FILE "nothing_bench_level.txt"
+#define BENCH_DELTA_TIME (1.0f / 60.0f)
+// Same as in level.c
+#define BENCH_GRAVITY 1500.0f
+// The render measures need the font of the game, so they only run
+// when nothing_bench is started from data/ like the game itself
+#define BENCH_FONT_FILE "images/charmap-oldschool.bmp"
+#define BENCH_SCREEN_WIDTH 800
+#define BENCH_SCREEN_HEIGHT 600
+#define BENCH_RENDER_RECTS 4096
+
+typedef struct {
+    const char *name;
+    void (*generate)(FILE *stream, size_t size);
+    size_t size;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"boxes_on_floor_100", synthetic_boxes_on_floor, 100},
+    {"boxes_on_floor_1000", synthetic_boxes_on_floor, 1000},
+    {"towers_500", synthetic_towers, 500},
+    {"lava_pools_500", synthetic_lava_pools, 500},
+    {"platform_field_5000", synthetic_platform_field, 5000}
+};
+static const size_t scenarios_count = sizeof(scenarios) / sizeof(scenarios[0]);
+
+static int generate_level_file(const Scenario *scenario)
+{
+    FILE *stream = fopen(BENCH_LEVEL_FILE, "w");
+    if (stream == NULL) {
+        log_fail("Could not open %s\n", BENCH_LEVEL_FILE);
+        return -1;
+    }
+
+    scenario->generate(stream, scenario->size);
+
+    fclose(stream);
+    return 0;
+}
+
+// Runs the same steps as level_update does for the bodies and
+// measures each of them separately
+static int bench_physics(const Scenario *scenario, size_t ticks, FILE *report)
+{
+    Lt *lt = create_lt();
+
+    LevelEditor *level_editor = PUSH_LT(
+        lt,
+        create_level_editor_from_file(BENCH_LEVEL_FILE),
+        destroy_level_editor);
+    if (level_editor == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    RigidBodies *rigid_bodies = PUSH_LT(
+        lt,
+        create_rigid_bodies(1024, BROADPHASE_UNIFORM_GRID),
+        destroy_rigid_bodies);
+    if (rigid_bodies == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Platforms *platforms = PUSH_LT(
+        lt,
+        create_platforms_from_rect_layer(level_editor->platforms_layer),
+        destroy_platforms);
+    if (platforms == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Lava *lava = PUSH_LT(
+        lt,
+        create_lava_from_rect_layer(level_editor->lava_layer),
+        destroy_lava);
+    if (lava == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Boxes *boxes = PUSH_LT(
+        lt,
+        create_boxes_from_rect_layer(level_editor->boxes_layer, rigid_bodies),
+        destroy_boxes);
+    if (boxes == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    const size_t boxes_count = rect_layer_count(level_editor->boxes_layer);
+    const Rect *boxes_rects = rect_layer_rects(level_editor->boxes_layer);
+
+    Measure float_in_lava, collide, snap_rect;
+    if (measure_init(&float_in_lava, "boxes_float_in_lava", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &float_in_lava, measure_free);
+
+    if (measure_init(&collide, "rigid_bodies_collide", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &collide, measure_free);
+
+    if (measure_init(&snap_rect, "platforms_snap_rect", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &snap_rect, measure_free);
+
+    for (size_t tick = 0; tick < ticks; ++tick) {
+        measure_begin(&float_in_lava);
+        boxes_float_in_lava(boxes, lava);
+        measure_end(&float_in_lava);
+
+        rigid_bodies_apply_omniforce(rigid_bodies, vec(0.0f, BENCH_GRAVITY));
+        rigid_bodies_integrate_all(rigid_bodies, BENCH_DELTA_TIME);
+
+        measure_begin(&collide);
+        if (rigid_bodies_collide(rigid_bodies, platforms) < 0) {
+            RETURN_LT(lt, -1);
+        }
+        measure_end(&collide);
+
+        // The initial boxes snapped to the platforms as if they were
+        // falling through them
+        measure_begin(&snap_rect);
+        for (size_t i = 0; i < boxes_count; ++i) {
+            Rect rect = boxes_rects[i];
+            rect.y += (float) (tick % 64);
+            platforms_snap_rect(platforms, &rect);
+        }
+        measure_end(&snap_rect);
+    }
+
+    measure_report(&float_in_lava, scenario->name, report);
+    measure_report(&collide, scenario->name, report);
+    measure_report(&snap_rect, scenario->name, report);
+
+    RETURN_LT(lt, 0);
+}
+
+static int bench_level_update(const Scenario *scenario, size_t ticks, FILE *report)
+{
+    Lt *lt = create_lt();
+
+    Game *game = PUSH_LT(
+        lt,
+        create_game("./levels/", NULL, 0, NULL),
+        destroy_game);
+    if (game == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    if (game_load_level(game, BENCH_LEVEL_FILE) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
+    Measure level_update;
+    if (measure_init(&level_update, "level_update", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &level_update, measure_free);
+
+    for (size_t tick = 0; tick < ticks && !game_over_check(game); ++tick) {
+        measure_begin(&level_update);
+        if (game_update(game, BENCH_DELTA_TIME) < 0) {
+            RETURN_LT(lt, -1);
+        }
+        measure_end(&level_update);
+    }
+
+    measure_report(&level_update, scenario->name, report);
+
+    RETURN_LT(lt, 0);
+}
+
+typedef struct {
+    const char *name;
+    // How many rects in a row have the same color
+    size_t run;
+} RenderScenario;
+
+static const RenderScenario render_scenarios[] = {
+    // Layers of one color on top of each other like the background,
+    // the lava and the platforms
+    {"render_layers", 512},
+    // Every rect has another color than the previous one and most of
+    // them overlap
+    {"render_interleaved", 1}
+};
+static const size_t render_scenarios_count =
+    sizeof(render_scenarios) / sizeof(render_scenarios[0]);
+
+static bool bench_font_exists(void)
+{
+    FILE *stream = fopen(BENCH_FONT_FILE, "rb");
+    if (stream == NULL) {
+        return false;
+    }
+
+    fclose(stream);
+    return true;
+}
+
+// Fills the same rects with camera_fill_rect_screen() and with a
+// draw call per rect on a software renderer
+static int bench_render_rects(const RenderScenario *scenario, size_t ticks, FILE *report)
+{
+    Lt *lt = create_lt();
+
+    SDL_Surface *surface = PUSH_LT(
+        lt,
+        SDL_CreateRGBSurfaceWithFormat(
+            0, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, 32,
+            SDL_PIXELFORMAT_RGBA8888),
+        SDL_FreeSurface);
+    if (surface == NULL) {
+        log_fail("SDL_CreateRGBSurfaceWithFormat: %s\n", SDL_GetError());
+        RETURN_LT(lt, -1);
+    }
+
+    SDL_Renderer *renderer = PUSH_LT(
+        lt,
+        SDL_CreateSoftwareRenderer(surface),
+        SDL_DestroyRenderer);
+    if (renderer == NULL) {
+        log_fail("SDL_CreateSoftwareRenderer: %s\n", SDL_GetError());
+        RETURN_LT(lt, -1);
+    }
+
+    Sprite_font *font = PUSH_LT(
+        lt,
+        create_sprite_font_from_file(BENCH_FONT_FILE, renderer),
+        destroy_sprite_font);
+    if (font == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Camera *camera = PUSH_LT(
+        lt,
+        create_camera(renderer, font),
+        destroy_camera);
+    if (camera == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Rect *rects = PUSH_LT(lt, nth_calloc(BENCH_RENDER_RECTS, sizeof(Rect)), free);
+    if (rects == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    Color *colors = PUSH_LT(lt, nth_calloc(BENCH_RENDER_RECTS, sizeof(Color)), free);
+    if (colors == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    const Color palette[] = {
+        hexstr("073642"),
+        hexstr("ff8080"),
+        hexstr("859900"),
+        hexstr("268bd2")
+    };
+    const size_t palette_count = sizeof(palette) / sizeof(palette[0]);
+
+    LocalRand local = local_rand(42);
+    for (size_t i = 0; i < BENCH_RENDER_RECTS; ++i) {
+        rects[i] = rect(
+            local_rand_float_range(&local, 0.0f, (float) BENCH_SCREEN_WIDTH),
+            local_rand_float_range(&local, 0.0f, (float) BENCH_SCREEN_HEIGHT),
+            local_rand_float_range(&local, 4.0f, 64.0f),
+            local_rand_float_range(&local, 4.0f, 64.0f));
+        colors[i] = palette[(i / scenario->run) % palette_count];
+    }
+
+    Measure batched, unbatched;
+    if (measure_init(&batched, "camera_fill_rect_screen", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &batched, measure_free);
+
+    if (measure_init(&unbatched, "sdl_render_fill_rect", ticks) < 0) {
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, &unbatched, measure_free);
+
+    for (size_t tick = 0; tick < ticks; ++tick) {
+        measure_begin(&batched);
+        for (size_t i = 0; i < BENCH_RENDER_RECTS; ++i) {
+            if (camera_fill_rect_screen(camera, rects[i], colors[i]) < 0) {
+                RETURN_LT(lt, -1);
+            }
+        }
+        if (camera_flush(camera) < 0) {
+            RETURN_LT(lt, -1);
+        }
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+        SDL_RenderFlush(renderer);
+#endif
+        measure_end(&batched);
+
+        measure_begin(&unbatched);
+        for (size_t i = 0; i < BENCH_RENDER_RECTS; ++i) {
+            const SDL_Color color = color_for_sdl(colors[i]);
+            const SDL_Rect sdl_rect = rect_for_sdl(rects[i]);
+            if (SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a) < 0
+                || SDL_RenderFillRect(renderer, &sdl_rect) < 0) {
+                log_fail("SDL error: %s\n", SDL_GetError());
+                RETURN_LT(lt, -1);
+            }
+        }
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+        SDL_RenderFlush(renderer);
+#endif
+        measure_end(&unbatched);
+    }
+
+    measure_report(&batched, scenario->name, report);
+    measure_report(&unbatched, scenario->name, report);
+
+    RETURN_LT(lt, 0);
+}
+
+static void print_usage(FILE *stream)
+{
+    fprintf(stream, "Usage: nothing_bench [--ticks <ticks>] [--scenario <name>]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int ticks = 300;
+    const char *scenario_name = NULL;
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            print_usage(stderr);
+            return -1;
+        }
+
+        if (strcmp(argv[i], "--ticks") == 0) {
+            if (sscanf(argv[i + 1], "%d", &ticks) != 1 || ticks <= 0) {
+                print_usage(stderr);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--scenario") == 0) {
+            scenario_name = argv[i + 1];
+        } else {
+            print_usage(stderr);
+            return -1;
+        }
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) < 0) {
+        log_fail("Could not initialize SDL: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    measure_report_header(stdout);
+
+    int result = 0;
+    for (size_t i = 0; i < scenarios_count && result == 0; ++i) {
+        if (scenario_name != NULL && strcmp(scenario_name, scenarios[i].name) != 0) {
+            continue;
+        }
+
+        if (generate_level_file(&scenarios[i]) < 0
+            || bench_physics(&scenarios[i], (size_t) ticks, stdout) < 0
+            || bench_level_update(&scenarios[i], (size_t) ticks, stdout) < 0) {
+            log_fail("Scenario %s failed\n", scenarios[i].name);
+            result = -1;
+        }
+    }
+
+    for (size_t i = 0; i < render_scenarios_count && result == 0; ++i) {
+        if (scenario_name != NULL && strcmp(scenario_name, render_scenarios[i].name) != 0) {
+            continue;
+        }
+
+        if (!bench_font_exists()) {
+            log_warn("Skipping the render measures: %s is not found. Run nothing_bench from data/\n",
+                     BENCH_FONT_FILE);
+            break;
+        }
+
+        if (bench_render_rects(&render_scenarios[i], (size_t) ticks, stdout) < 0) {
+            log_fail("Scenario %s failed\n", render_scenarios[i].name);
+            result = -1;
+        }
+    }
+
+    remove(BENCH_LEVEL_FILE);
+    SDL_Quit();
+
+    return result;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+
+#include "./synthetic_levels.h"
+
+#define SYNTHETIC_BOX_SIZE 64
+#define SYNTHETIC_FLOOR_Y 0
+
+// The sections of a level file follow the order of
+// create_level_editor_from_file
+
+static void synthetic_header(FILE *stream, const char *title)
+{
+    fprintf(stream, "%s\n", title);
+    fprintf(stream, "fffda5\n");
+    fprintf(stream, "0.0 -100.0 ff8080\n");
+}
+
+static void synthetic_rect(FILE *stream, const char *prefix, size_t i,
+                           long x, long y, long w, long h,
+                           const char *color)
+{
+    fprintf(stream, "%s%lu %ld %ld %ld %ld %s\n",
+            prefix, (unsigned long) i, x, y, w, h, color);
+}
+
+static void synthetic_floor(FILE *stream, long x, long w)
+{
+    synthetic_rect(stream, "floor", 0, x, SYNTHETIC_FLOOR_Y, w, 100, "483737");
+}
+
+static void synthetic_boxes_grid(FILE *stream, size_t count,
+                                 long x, long y, size_t columns,
+                                 long step_x, long step_y)
+{
+    fprintf(stream, "%lu\n", (unsigned long) count);
+    for (size_t i = 0; i < count; ++i) {
+        synthetic_rect(stream, "box", i,
+                       x + (long) (i % columns) * step_x,
+                       y - (long) (i / columns) * step_y,
+                       SYNTHETIC_BOX_SIZE, SYNTHETIC_BOX_SIZE,
+                       "a02c2c");
+    }
+}
+
+static void synthetic_footer(FILE *stream)
+{
+    // labels, regions and an empty script
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+}
+
+void synthetic_boxes_on_floor(FILE *stream, size_t size)
+{
+    const size_t columns = size < 50 ? size : 50;
+    const long width = (long) columns * 150 + 400;
+
+    synthetic_header(stream, "Boxes on Floor");
+
+    fprintf(stream, "1\n");
+    synthetic_floor(stream, -200, width);
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    synthetic_boxes_grid(stream, size, 0, SYNTHETIC_FLOOR_Y - 70, columns, 150, 70);
+
+    synthetic_footer(stream);
+}
+
+void synthetic_towers(FILE *stream, size_t size)
+{
+    const size_t columns = size / 20 > 0 ? size / 20 : 1;
+    const long width = (long) columns * 200 + 400;
+
+    synthetic_header(stream, "Towers");
+
+    fprintf(stream, "1\n");
+    synthetic_floor(stream, -200, width);
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    synthetic_boxes_grid(stream, size, 0, SYNTHETIC_FLOOR_Y - SYNTHETIC_BOX_SIZE,
+                         columns, 200, SYNTHETIC_BOX_SIZE);
+
+    synthetic_footer(stream);
+}
+
+void synthetic_lava_pools(FILE *stream, size_t size)
+{
+    const size_t columns = size < 40 ? size : 40;
+    const size_t pools = 8;
+    const long width = (long) columns * 100;
+    const long pool_width = width / (long) pools;
+
+    synthetic_header(stream, "Lava Pools");
+
+    fprintf(stream, "1\n");
+    synthetic_floor(stream, -200, width + 400);
+    fprintf(stream, "0\n");
+    fprintf(stream, "%lu\n", (unsigned long) pools);
+    for (size_t i = 0; i < pools; ++i) {
+        synthetic_rect(stream, "lava", i,
+                       (long) i * pool_width, SYNTHETIC_FLOOR_Y - 200,
+                       pool_width - 50, 200,
+                       "d35f5f");
+    }
+    fprintf(stream, "0\n");
+    synthetic_boxes_grid(stream, size, 0, SYNTHETIC_FLOOR_Y - 400, columns, 100, 100);
+
+    synthetic_footer(stream);
+}
+
+void synthetic_platform_field(FILE *stream, size_t size)
+{
+    const size_t boxes_count = 200;
+    const long width = 8000;
+
+    synthetic_header(stream, "Platform Field");
+
+    fprintf(stream, "%lu\n", (unsigned long) size + 1);
+    synthetic_floor(stream, -200, width + 400);
+    for (size_t i = 0; i < size; ++i) {
+        synthetic_rect(stream, "platform", i,
+                       (long) (i * 37 % (size_t) width),
+                       SYNTHETIC_FLOOR_Y - 200 - (long) (i * 53 % 2500),
+                       60 + (long) (i % 5) * 10, 18,
+                       "483737");
+    }
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    fprintf(stream, "0\n");
+    synthetic_boxes_grid(stream, boxes_count, 0, SYNTHETIC_FLOOR_Y - 3000, 40, 200, 100);
+
+    synthetic_footer(stream);
+}
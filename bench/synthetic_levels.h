@@ -0,0 +1,15 @@
+#ifndef SYNTHETIC_LEVELS_H_
+#define SYNTHETIC_LEVELS_H_
+
+#include <stdio.h>
+
+// `size` boxes dropped in a loose grid on a single floor
+void synthetic_boxes_on_floor(FILE *stream, size_t size);
+// Towers of 20 boxes stacked on top of each other
+void synthetic_towers(FILE *stream, size_t size);
+// Boxes falling into a row of lava pools
+void synthetic_lava_pools(FILE *stream, size_t size);
+// Thousands of small platforms with a rain of boxes over them
+void synthetic_platform_field(FILE *stream, size_t size);
+
+#endif  // SYNTHETIC_LEVELS_H_
@@ -19,5 +19,7 @@ bool dynarray_contains(const Dynarray *dynarray,
                        const void *element);
 // O(N)
 void dynarray_delete_at(Dynarray *dynarray, size_t index);
+// O(1). Copies the last element into `element` unless it's NULL
+void dynarray_pop(Dynarray *dynarray, void *element);
 
 #endif  // DYNARRAY_H_
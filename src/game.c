@@ -1,11 +1,13 @@
 #include <SDL.h>
 #include "system/stacktrace.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "game.h"
 #include "game/level.h"
 #include "game/sound_samples.h"
 #include "game/level_picker.h"
+#include "game/replay.h"
 #include "system/log.h"
 #include "system/lt.h"
 #include "system/nth_alloc.h"
@@ -44,6 +46,18 @@ typedef struct Game {
     SDL_Texture *texture_cursor;
     int cursor_x;
     int cursor_y;
+    size_t physics_threads;
+
+    // The first level loaded after game_record_replay() is recorded
+    // until it's replaced by another one
+    const char *replay_filename;
+    float replay_delta_time;
+    ReplayWriter *replay_writer;
+
+    // See game_play_replay()
+    ReplayReader *replay_reader;
+    ReplayRecord replay_record;
+    uint32_t replay_tick;
 } Game;
 
 Game *create_game(const char *level_folder,
@@ -71,44 +85,26 @@ Game *create_game(const char *level_folder,
         RETURN_LT(lt, NULL);
     }
 
-    game->font = PUSH_LT(
-        lt,
-        create_sprite_font_from_file(
-            "images/charmap-oldschool.bmp",
-            renderer),
-        destroy_sprite_font);
-    if (game->font == NULL) {
-        RETURN_LT(lt, NULL);
-    }
-
-    game->level_picker = PUSH_LT(
-        lt,
-        create_level_picker(
-            game->font,
-            level_folder),
-        destroy_level_picker);
-    if (game->level_picker == NULL) {
-        RETURN_LT(lt, NULL);
-    }
-
-    game->sound_samples = PUSH_LT(
-        lt,
-        create_sound_samples(
-            sound_sample_files,
-            sound_sample_files_count),
-        destroy_sound_samples);
-    if (game->sound_samples == NULL) {
-        RETURN_LT(lt, NULL);
-    }
+    game->renderer = renderer;
 
-    game->camera = PUSH_LT(
-        lt,
-        create_camera(renderer, game->font),
-        destroy_camera);
-    if (game->camera == NULL) {
-        RETURN_LT(lt, NULL);
+    // Without a renderer the game runs headless: nothing that only
+    // draws, plays or reads the input is created
+    if (renderer != NULL) {
+        game->font = PUSH_LT(
+            lt,
+            create_sprite_font_from_file(
+                "images/charmap-oldschool.bmp",
+                renderer),
+            destroy_sprite_font);
+        if (game->font == NULL) {
+            RETURN_LT(lt, NULL);
+        }
     }
 
+    // The console is needed even headless to play the replays back.
+    // It just never renders anything then, so only a game with a
+    // renderer needs the font for its log.
+    trace_assert(renderer == NULL || game->font != NULL);
     game->console = PUSH_LT(
         lt,
         create_console(game->broadcast, game->font),
@@ -117,51 +113,124 @@ Game *create_game(const char *level_folder,
         RETURN_LT(lt, NULL);
     }
 
-    game->renderer = renderer;
-    game->texture_cursor = PUSH_LT(
-        lt,
-        texture_from_bmp("images/cursor.bmp", renderer),
-        SDL_DestroyTexture);
-    if (SDL_SetTextureBlendMode(
-            game->texture_cursor,
-            SDL_ComposeCustomBlendMode(
-                SDL_BLENDFACTOR_ONE_MINUS_DST_COLOR,
-                SDL_BLENDFACTOR_ONE_MINUS_SRC_COLOR,
-                SDL_BLENDOPERATION_ADD,
-                SDL_BLENDFACTOR_ONE,
-                SDL_BLENDFACTOR_ZERO,
-                SDL_BLENDOPERATION_ADD)) < 0) {
-        log_warn("SDL error: %s\n", SDL_GetError());
+    if (renderer != NULL) {
+        game->level_picker = PUSH_LT(
+            lt,
+            create_level_picker(
+                game->font,
+                level_folder),
+            destroy_level_picker);
+        if (game->level_picker == NULL) {
+            RETURN_LT(lt, NULL);
+        }
+
+        game->sound_samples = PUSH_LT(
+            lt,
+            create_sound_samples(
+                sound_sample_files,
+                sound_sample_files_count),
+            destroy_sound_samples);
+        if (game->sound_samples == NULL) {
+            RETURN_LT(lt, NULL);
+        }
+
+        game->camera = PUSH_LT(
+            lt,
+            create_camera(renderer, game->font),
+            destroy_camera);
+        if (game->camera == NULL) {
+            RETURN_LT(lt, NULL);
+        }
+
+        game->texture_cursor = PUSH_LT(
+            lt,
+            texture_from_bmp("images/cursor.bmp", renderer),
+            SDL_DestroyTexture);
+        if (SDL_SetTextureBlendMode(
+                game->texture_cursor,
+                SDL_ComposeCustomBlendMode(
+                    SDL_BLENDFACTOR_ONE_MINUS_DST_COLOR,
+                    SDL_BLENDFACTOR_ONE_MINUS_SRC_COLOR,
+                    SDL_BLENDOPERATION_ADD,
+                    SDL_BLENDFACTOR_ONE,
+                    SDL_BLENDFACTOR_ZERO,
+                    SDL_BLENDOPERATION_ADD)) < 0) {
+            log_warn("SDL error: %s\n", SDL_GetError());
+        }
     }
+
     game->cursor_x = 0;
     game->cursor_y = 0;
 
     return game;
 }
 
+static int game_stop_recording(Game *game)
+{
+    trace_assert(game);
+
+    if (game->replay_writer == NULL) {
+        return 0;
+    }
+
+    int result = 0;
+    if (game->level != NULL) {
+        level_record(game->level, NULL);
+        result = replay_writer_finish(game->replay_writer, level_checksum(game->level));
+    }
+
+    destroy_replay_writer(RELEASE_LT(game->lt, game->replay_writer));
+    game->replay_writer = NULL;
+
+    if (result < 0) {
+        log_fail("Could not finish the replay %s\n", game->replay_filename);
+    } else {
+        log_info("Saved the replay to %s\n", game->replay_filename);
+    }
+    game->replay_filename = NULL;
+
+    return result;
+}
+
 void destroy_game(Game *game)
 {
     trace_assert(game);
+    game_stop_recording(game);
     RETURN_LT0(game->lt);
 }
 
-int game_render(const Game *game)
+int game_render(const Game *game, float alpha)
 {
     trace_assert(game);
 
+    camera_begin_frame(game->camera);
+
     switch(game->state) {
-    case GAME_STATE_RUNNING:
+    case GAME_STATE_RUNNING: {
+        level_before_render(game->level, game->camera, alpha);
+        if (level_render(game->level, game->camera) < 0) {
+            return -1;
+        }
+    } break;
+
     case GAME_STATE_PAUSE: {
+        // Nothing moves while the game is paused
+        level_before_render(game->level, game->camera, 1.0f);
         if (level_render(game->level, game->camera) < 0) {
             return -1;
         }
     } break;
 
     case GAME_STATE_CONSOLE: {
+        level_before_render(game->level, game->camera, alpha);
         if (level_render(game->level, game->camera) < 0) {
             return -1;
         }
 
+        if (camera_flush(game->camera) < 0) {
+            return -1;
+        }
+
         if (console_render(game->console, game->camera, game->renderer) < 0) {
             return -1;
         }
@@ -190,7 +259,7 @@ int game_render(const Game *game)
     case GAME_STATE_QUIT: break;
     }
 
-    return 0;
+    return camera_flush(game->camera);
 }
 
 int game_sound(Game *game)
@@ -209,6 +278,198 @@ int game_sound(Game *game)
     return 0;
 }
 
+// All of the levels of the game are created here, so they share the
+// same settings
+static Level *game_create_level(Game *game)
+{
+    trace_assert(game);
+
+    // A replay covers a single level from the beginning
+    game_stop_recording(game);
+
+    Level *level = create_level_from_level_editor(
+        game->level_editor,
+        game->broadcast);
+    if (level == NULL) {
+        return NULL;
+    }
+
+    if (level_set_physics_threads(level, game->physics_threads) < 0) {
+        destroy_level(level);
+        return NULL;
+    }
+
+    return level;
+}
+
+int game_set_physics_threads(Game *game, size_t threads_count)
+{
+    trace_assert(game);
+
+    game->physics_threads = threads_count;
+
+    if (game->level != NULL) {
+        return level_set_physics_threads(game->level, threads_count);
+    }
+
+    return 0;
+}
+
+int game_load_level(Game *game, const char *level_filename)
+{
+    trace_assert(game);
+    trace_assert(level_filename);
+
+    // rand() is reseeded with a seed that is recorded, so the playback
+    // loads the level from the same state of rand()
+    const bool recording = game->replay_filename != NULL && game->replay_writer == NULL;
+    uint32_t seed = 0;
+    if (recording) {
+        seed = (uint32_t) rand();
+        srand(seed);
+    }
+
+    if (game->level_editor == NULL) {
+        game->level_editor = PUSH_LT(
+            game->lt,
+            create_level_editor_from_file(level_filename),
+            destroy_level_editor);
+    } else {
+        game->level_editor = RESET_LT(
+            game->lt,
+            game->level_editor,
+            create_level_editor_from_file(level_filename));
+    }
+
+    if (game->level_editor == NULL) {
+        return -1;
+    }
+
+    if (game->level == NULL) {
+        game->level = PUSH_LT(
+            game->lt,
+            game_create_level(game),
+            destroy_level);
+    } else {
+        game->level = RESET_LT(
+            game->lt,
+            game->level,
+            game_create_level(game));
+    }
+
+    if (game->level == NULL) {
+        return -1;
+    }
+
+    game->state = GAME_STATE_RUNNING;
+
+    if (recording) {
+        game->replay_writer = PUSH_LT(
+            game->lt,
+            create_replay_writer(
+                game->replay_filename,
+                seed,
+                game->replay_delta_time,
+                level_filename),
+            destroy_replay_writer);
+        if (game->replay_writer == NULL) {
+            return -1;
+        }
+        level_record(game->level, game->replay_writer);
+    }
+
+    return 0;
+}
+
+int game_record_replay(Game *game, const char *replay_filename, float delta_time)
+{
+    trace_assert(game);
+    trace_assert(replay_filename);
+    trace_assert(delta_time > 0.0f);
+
+    if (game_stop_recording(game) < 0) {
+        return -1;
+    }
+
+    game->replay_filename = replay_filename;
+    game->replay_delta_time = delta_time;
+
+    return 0;
+}
+
+int game_play_replay(Game *game, const char *replay_filename, float *delta_time)
+{
+    trace_assert(game);
+    trace_assert(replay_filename);
+    trace_assert(delta_time);
+    trace_assert(game->replay_reader == NULL);
+
+    game->replay_reader = PUSH_LT(
+        game->lt,
+        create_replay_reader(replay_filename),
+        destroy_replay_reader);
+    if (game->replay_reader == NULL) {
+        return -1;
+    }
+
+    srand(replay_reader_seed(game->replay_reader));
+
+    if (game_load_level(game, replay_reader_level_filename(game->replay_reader)) < 0) {
+        return -1;
+    }
+
+    game->replay_tick = 0;
+    *delta_time = replay_reader_delta_time(game->replay_reader);
+
+    return replay_reader_next(game->replay_reader, &game->replay_record);
+}
+
+// Feeds the level everything that was recorded before the current
+// tick. Quits the game at the end of the replay.
+static int game_play_replay_tick(Game *game)
+{
+    trace_assert(game);
+    trace_assert(game->replay_reader);
+
+    while (game->replay_record.tick == game->replay_tick) {
+        switch (game->replay_record.kind) {
+        case REPLAY_ACTION: {
+            if (level_act(game->level, game->replay_record.action) < 0) {
+                return -1;
+            }
+        } break;
+
+        case REPLAY_CONSOLE: {
+            if (console_eval(game->console, game->replay_record.line) < 0) {
+                return -1;
+            }
+        } break;
+
+        case REPLAY_END: {
+            const uint64_t checksum = level_checksum(game->level);
+            game->state = GAME_STATE_QUIT;
+
+            if (checksum != game->replay_record.checksum) {
+                log_fail("The replay diverged after %u ticks: checksum %016llx, expected %016llx\n",
+                         game->replay_tick,
+                         (unsigned long long) checksum,
+                         (unsigned long long) game->replay_record.checksum);
+                return -1;
+            }
+
+            log_info("The replay matched after %u ticks\n", game->replay_tick);
+            return 0;
+        }
+        }
+
+        if (replay_reader_next(game->replay_reader, &game->replay_record) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 int game_update(Game *game, float delta_time)
 {
     trace_assert(game);
@@ -216,11 +477,36 @@ int game_update(Game *game, float delta_time)
 
     switch (game->state) {
     case GAME_STATE_RUNNING: {
+        if (game->replay_reader != NULL) {
+            if (delta_time != replay_reader_delta_time(game->replay_reader)) {
+                log_fail("The replay was recorded with the time step %f, not %f\n",
+                         (double) replay_reader_delta_time(game->replay_reader),
+                         (double) delta_time);
+                return -1;
+            }
+
+            if (game_play_replay_tick(game) < 0) {
+                return -1;
+            }
+
+            if (game->state == GAME_STATE_QUIT) {
+                return 0;
+            }
+
+            game->replay_tick++;
+        }
+
         if (level_update(game->level, delta_time) < 0) {
             return -1;
         }
 
-        if (level_enter_camera_event(game->level, game->camera) < 0) {
+        if (game->replay_writer != NULL) {
+            replay_writer_tick(game->replay_writer);
+        }
+
+        // There is no camera to enter when the game runs headless
+        if (game->camera != NULL
+            && level_enter_camera_event(game->level, game->camera) < 0) {
             return -1;
         }
 
@@ -231,7 +517,12 @@ int game_update(Game *game, float delta_time)
             return -1;
         }
 
-        if (level_enter_camera_event(game->level, game->camera) < 0) {
+        if (game->replay_writer != NULL) {
+            replay_writer_tick(game->replay_writer);
+        }
+
+        if (game->camera != NULL
+            && level_enter_camera_event(game->level, game->camera) < 0) {
             return -1;
         }
 
@@ -252,43 +543,9 @@ int game_update(Game *game, float delta_time)
         const char *level_filename = level_picker_selected_level(game->level_picker);
 
         if (level_filename != NULL) {
-            if (game->level_editor == NULL) {
-                game->level_editor = PUSH_LT(
-                    game->lt,
-                    create_level_editor_from_file(level_filename),
-                    destroy_level_editor);
-            } else {
-                game->level_editor = RESET_LT(
-                    game->lt,
-                    game->level_editor,
-                    create_level_editor_from_file(level_filename));
-            }
-
-            if (game->level_editor == NULL) {
+            if (game_load_level(game, level_filename) < 0) {
                 return -1;
             }
-
-            if (game->level == NULL) {
-                game->level = PUSH_LT(
-                    game->lt,
-                    create_level_from_level_editor(
-                        game->level_editor,
-                        game->broadcast),
-                    destroy_level);
-            } else {
-                game->level = RESET_LT(
-                    game->lt,
-                    game->level,
-                    create_level_from_level_editor(
-                        game->level_editor,
-                        game->broadcast));
-            }
-
-            if (game->level == NULL) {
-                return -1;
-            }
-
-            game->state = GAME_STATE_RUNNING;
         }
 
     } break;
@@ -367,9 +624,7 @@ static int game_event_running(Game *game, const SDL_Event *event)
             game->level = RESET_LT(
                 game->lt,
                 game->level,
-                create_level_from_level_editor(
-                    game->level_editor,
-                    game->broadcast));
+                game_create_level(game));
             if (game->level == NULL) {
                 log_fail("Could not reload level %s\n", level_filename);
                 game->state = GAME_STATE_QUIT;
@@ -421,6 +676,15 @@ static int game_event_console(Game *game, const SDL_Event *event)
             game->state = GAME_STATE_RUNNING;
             return 0;
 
+        case SDLK_RETURN:
+            if (game->replay_writer != NULL
+                && replay_writer_console(
+                    game->replay_writer,
+                    console_input(game->console)) < 0) {
+                return -1;
+            }
+            break;
+
         default: {}
         }
 
@@ -458,17 +722,13 @@ static int game_event_level_picker(Game *game, const SDL_Event *event)
             if (game->level == NULL) {
                 game->level = PUSH_LT(
                     game->lt,
-                    create_level_from_level_editor(
-                        game->level_editor,
-                        game->broadcast),
+                    game_create_level(game),
                     destroy_level);
             } else {
                 game->level = RESET_LT(
                     game->lt,
                     game->level,
-                    create_level_from_level_editor(
-                        game->level_editor,
-                        game->broadcast));
+                    game_create_level(game));
             }
 
             if (game->level == NULL) {
@@ -496,9 +756,7 @@ static int game_event_level_editor(Game *game, const SDL_Event *event)
             game->level = RESET_LT(
                 game->lt,
                 game->level,
-                create_level_from_level_editor(
-                    game->level_editor,
-                    game->broadcast));
+                game_create_level(game));
             if (game->level == NULL) {
                 return -1;
             }
@@ -598,7 +856,7 @@ game_send(Game *game, Gc *gc, struct Scope *scope,
 
     if (strcmp(target, "level") == 0) {
         return level_send(game->level, gc, scope, rest);
-    } else if (strcmp(target, "menu") == 0) {
+    } else if (strcmp(target, "menu") == 0 && game->level_picker != NULL) {
         level_picker_clean_selection(game->level_picker);
         game->state = GAME_STATE_LEVEL_PICKER;
         return eval_success(NIL(gc));
@@ -613,6 +871,10 @@ static int game_render_cursor(const Game *game)
 {
     trace_assert(game);
 
+    if (camera_flush(game->camera) < 0) {
+        return -1;
+    }
+
     SDL_Rect src = {0, 0, 32, 32};
     SDL_Rect dest = {game->cursor_x, game->cursor_y, 32, 32};
     if (SDL_RenderCopy(game->renderer, game->texture_cursor, &src, &dest) < 0) {
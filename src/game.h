@@ -2,19 +2,44 @@
 #define GAME_H_
 
 #include <SDL.h>
+#include <stdint.h>
 
 #include "game/sound_samples.h"
 #include "ebisp/expr.h"
 
 typedef struct Game Game;
 
+// With a NULL `renderer` the game is headless. It can only load and
+// update levels.
 Game *create_game(const char *platforms_file_path,
                     const char *sound_sample_files[],
                     size_t sound_sample_files_count,
                     SDL_Renderer *renderer);
 void destroy_game(Game *game);
 
-int game_render(const Game *game);
+// Replaces the current level with the one from `level_filename` and
+// starts running it
+int game_load_level(Game *game, const char *level_filename);
+
+// Records the next level that is loaded by game_load_level() to
+// `replay_filename`, see replay.h. The level must be updated by
+// `delta_time` at a time. The recording ends when the level is
+// replaced or the game is destroyed.
+int game_record_replay(Game *game, const char *replay_filename, float delta_time);
+// Loads the level of the replay and feeds it the recorded input on
+// each game_update(). Sets `*delta_time` to the time step the replay
+// was recorded with; game_update() fails with any other one. The game
+// quits at the end of the replay and game_update() fails if the level
+// ended up in a different state than during the recording.
+int game_play_replay(Game *game, const char *replay_filename, float *delta_time);
+
+// See rigid_bodies_set_island_threads(). Applies to the current level
+// and all of the levels loaded after that.
+int game_set_physics_threads(Game *game, size_t threads_count);
+
+// `alpha` is how far the rendered frame is between the last two
+// updates
+int game_render(const Game *game, float alpha);
 int game_sound(Game *game);
 int game_update(Game *game, float delta_time);
 
@@ -2,6 +2,8 @@
 #include "system/stacktrace.h"
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "camera.h"
 #include "sdl/renderer.h"
@@ -10,6 +12,10 @@
 
 #define RATIO_X 16.0f
 #define RATIO_Y 9.0f
+// How many filled rects are recorded before they are drawn
+#define CAMERA_FILL_RECTS_CAPACITY 256
+// How many filled triangles are recorded before they are drawn
+#define CAMERA_FILL_TRIANGLES_CAPACITY 1024
 
 struct Camera {
     bool debug_mode;
@@ -18,12 +24,52 @@ struct Camera {
     float scale;
     SDL_Renderer *renderer;
     Sprite_font *font;
+
+    // Updated when the camera moves and on camera_begin_frame(), so
+    // the viewport of the renderer is fetched about once per frame
+    SDL_Rect screen_view_port;
+    Vec effective_scale;
+    // camera_point(p) is p * transform_scale + transform_offset
+    Vec transform_scale;
+    Vec transform_offset;
+    // The part of the world visible through the camera
+    Rect view_port;
+    // How many objects were drawn and culled during this frame
+    size_t drawn_count;
+    size_t culled_count;
+
+    // The filled rects waiting for camera_flush() in the order they
+    // were recorded. No two of them of different colors overlap, so
+    // they can be drawn color by color.
+    SDL_Rect fill_rects[CAMERA_FILL_RECTS_CAPACITY];
+    SDL_Color fill_colors[CAMERA_FILL_RECTS_CAPACITY];
+    // Where the run of the rects of the same color each rect belongs
+    // to starts
+    size_t fill_runs[CAMERA_FILL_RECTS_CAPACITY];
+    size_t fill_count;
+    // Scratch of camera_flush()
+    bool fill_drawn[CAMERA_FILL_RECTS_CAPACITY];
+    SDL_Rect fill_batch[CAMERA_FILL_RECTS_CAPACITY];
+
+    // The filled triangles waiting for camera_flush(). Either the
+    // rects or the triangles are recorded at a time, so they are
+    // drawn in the same order as they were recorded.
+    SDL_Vertex fill_vertices[CAMERA_FILL_TRIANGLES_CAPACITY * 3];
+    size_t fill_triangles_count;
+    // Set when SDL_RenderGeometry() does not work and the triangles
+    // are rasterized line by line
+    bool geometry_broken;
 };
 
 static Vec effective_ratio(const SDL_Rect *view_port);
 static Vec effective_scale(const SDL_Rect *view_port);
 static Triangle camera_triangle(const Camera *camera,
                                 const Triangle t);
+static int camera_record_fill_rect(Camera *camera,
+                                   SDL_Rect rect,
+                                   Color color);
+static SDL_Color camera_fill_color(const Camera *camera, Color color);
+static void camera_update_view_port(Camera *camera);
 
 Camera *create_camera(SDL_Renderer *renderer,
                       Sprite_font *font)
@@ -43,6 +89,7 @@ Camera *create_camera(SDL_Renderer *renderer,
     camera->blackwhite_mode = 0;
     camera->renderer = renderer;
     camera->font = font;
+    camera_update_view_port(camera);
 
     return camera;
 }
@@ -60,29 +107,10 @@ int camera_fill_rect(Camera *camera,
 {
     trace_assert(camera);
 
-    const SDL_Rect sdl_rect = rect_for_sdl(
-        camera_rect(camera, rect));
-
-    const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
-
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    }
-
-    if (SDL_RenderFillRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderFillRect: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    return 0;
+    return camera_record_fill_rect(
+        camera,
+        rect_for_sdl(camera_rect(camera, rect)),
+        color);
 }
 
 int camera_draw_rect(Camera *camera,
@@ -91,6 +119,10 @@ int camera_draw_rect(Camera *camera,
 {
     trace_assert(camera);
 
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
     const SDL_Rect sdl_rect = rect_for_sdl(
         camera_rect(camera, rect));
 
@@ -115,6 +147,10 @@ int camera_draw_rect_screen(Camera *camera,
 {
     trace_assert(camera);
 
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
     const SDL_Rect sdl_rect = rect_for_sdl(rect);
     const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
 
@@ -137,6 +173,10 @@ int camera_draw_triangle(Camera *camera,
 {
     trace_assert(camera);
 
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
     const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
 
     if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
@@ -157,23 +197,25 @@ int camera_fill_triangle(Camera *camera,
 {
     trace_assert(camera);
 
-    const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
-
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
+    if ((camera->fill_count > 0
+         || camera->fill_triangles_count >= CAMERA_FILL_TRIANGLES_CAPACITY)
+        && camera_flush(camera) < 0) {
+        return -1;
     }
 
-    if (fill_triangle(camera->renderer, camera_triangle(camera, t)) < 0) {
-        return -1;
+    const SDL_Color sdl_color = camera_fill_color(camera, color);
+    const Triangle screen = camera_triangle(camera, t);
+    const Point points[3] = {screen.p1, screen.p2, screen.p3};
+
+    SDL_Vertex *vertices = camera->fill_vertices + camera->fill_triangles_count * 3;
+    for (size_t i = 0; i < 3; ++i) {
+        vertices[i].position.x = points[i].x;
+        vertices[i].position.y = points[i].y;
+        vertices[i].color = sdl_color;
+        vertices[i].tex_coord.x = 0.0f;
+        vertices[i].tex_coord.y = 0.0f;
     }
+    camera->fill_triangles_count++;
 
     return 0;
 }
@@ -184,10 +226,13 @@ int camera_render_text(Camera *camera,
                        Color c,
                        Vec position)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    trace_assert(camera);
+
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
 
-    const Vec scale = effective_scale(&view_port);
+    const Vec scale = camera->effective_scale;
     const Vec screen_position = camera_point(camera, position);
 
     if (sprite_font_render_text(
@@ -229,6 +274,12 @@ int camera_render_debug_text(Camera *camera,
 int camera_clear_background(Camera *camera,
                             Color color)
 {
+    trace_assert(camera);
+
+    // Everything recorded so far is about to be cleared anyway
+    camera->fill_count = 0;
+    camera->fill_triangles_count = 0;
+
     const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
 
     if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
@@ -248,12 +299,14 @@ void camera_center_at(Camera *camera, Point position)
 {
     trace_assert(camera);
     camera->position = position;
+    camera_update_view_port(camera);
 }
 
 void camera_scale(Camera *camera, float scale)
 {
     trace_assert(camera);
     camera->scale = fmaxf(0.1f, scale);
+    camera_update_view_port(camera);
 }
 
 void camera_toggle_debug_mode(Camera *camera)
@@ -276,38 +329,71 @@ void camera_toggle_blackwhite_mode(Camera *camera)
 
 int camera_is_point_visible(const Camera *camera, Point p)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    trace_assert(camera);
 
     return rect_contains_point(
-        rect_from_sdl(&view_port),
+        rect_from_sdl(&camera->screen_view_port),
         camera_point(camera, p));
 }
 
 Rect camera_view_port(const Camera *camera)
+{
+    trace_assert(camera);
+    return camera->view_port;
+}
+
+void camera_begin_frame(Camera *camera)
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    // The window might have been resized since the previous frame
+    camera_update_view_port(camera);
+    camera->drawn_count = 0;
+    camera->culled_count = 0;
+}
 
-    const Vec s = effective_scale(&view_port);
-    const float w = (float) view_port.w * s.x;
-    const float h = (float) view_port.h * s.y;
+bool camera_is_rect_visible(Camera *camera, Rect rect)
+{
+    trace_assert(camera);
 
-    return rect(camera->position.x - w * 0.5f,
-                camera->position.y - h * 0.5f,
-                w, h);
+    if (rects_overlap(camera->view_port, rect)) {
+        camera->drawn_count++;
+        return true;
+    }
+
+    camera->culled_count++;
+    return false;
 }
 
-Rect camera_view_port_screen(const Camera *camera)
+void camera_count_culled(Camera *camera, size_t drawn, size_t culled)
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    camera->drawn_count += drawn;
+    camera->culled_count += culled;
+}
+
+int camera_render_culling_stats(Camera *camera)
+{
+    trace_assert(camera);
 
-    return rect_from_sdl(&view_port);
+    char text_buffer[256];
+
+    snprintf(text_buffer, 256, "culling: %zu drawn, %zu culled",
+             camera->drawn_count,
+             camera->culled_count);
+
+    return camera_render_debug_text(
+        camera,
+        text_buffer,
+        vec(camera->view_port.x + 10.0f,
+            camera->view_port.y + 10.0f + FONT_CHAR_HEIGHT * 2.0f));
+}
+
+Rect camera_view_port_screen(const Camera *camera)
+{
+    trace_assert(camera);
+    return rect_from_sdl(&camera->screen_view_port);
 }
 
 int camera_is_text_visible(const Camera *camera,
@@ -318,9 +404,6 @@ int camera_is_text_visible(const Camera *camera,
     trace_assert(camera);
     trace_assert(text);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
-
     return rects_overlap(
         camera_rect(
             camera,
@@ -329,11 +412,190 @@ int camera_is_text_visible(const Camera *camera,
                 position,
                 size,
                 text)),
-        rect_from_sdl(&view_port));
+        rect_from_sdl(&camera->screen_view_port));
+}
+
+static bool sdl_colors_equal(SDL_Color a, SDL_Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool sdl_rects_overlap(const SDL_Rect *a, const SDL_Rect *b)
+{
+    return a->x < b->x + b->w && b->x < a->x + a->w
+        && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static int camera_flush_rects(Camera *camera)
+{
+    trace_assert(camera);
+
+    memset(camera->fill_drawn, 0, camera->fill_count * sizeof(bool));
+
+    for (size_t i = 0; i < camera->fill_count; ++i) {
+        if (camera->fill_drawn[i]) {
+            continue;
+        }
+
+        const SDL_Color color = camera->fill_colors[i];
+        size_t batch_count = 0;
+
+        // The order of the rects of the same color does not change the
+        // picture, and the rects of the other colors do not overlap
+        // them, see camera_record_fill_rect()
+        for (size_t j = i; j < camera->fill_count; ++j) {
+            if (!camera->fill_drawn[j]
+                && sdl_colors_equal(camera->fill_colors[j], color)) {
+                camera->fill_batch[batch_count++] = camera->fill_rects[j];
+                camera->fill_drawn[j] = true;
+            }
+        }
+
+        if (SDL_SetRenderDrawColor(camera->renderer, color.r, color.g, color.b, color.a) < 0) {
+            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
+            camera->fill_count = 0;
+            return -1;
+        }
+
+        if (SDL_RenderFillRects(camera->renderer, camera->fill_batch, (int) batch_count) < 0) {
+            log_fail("SDL_RenderFillRects: %s\n", SDL_GetError());
+            camera->fill_count = 0;
+            return -1;
+        }
+    }
+
+    camera->fill_count = 0;
+
+    return 0;
+}
+
+static int camera_flush_triangles(Camera *camera)
+{
+    trace_assert(camera);
+
+    const size_t count = camera->fill_triangles_count;
+    camera->fill_triangles_count = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!camera->geometry_broken) {
+        // The colors are in the vertices, so all of the triangles go
+        // in a single call
+        if (SDL_RenderGeometry(
+                camera->renderer, NULL,
+                camera->fill_vertices, (int) (count * 3),
+                NULL, 0) == 0) {
+            return 0;
+        }
+
+        log_warn("SDL_RenderGeometry: %s. Rasterizing the triangles line by line\n",
+                 SDL_GetError());
+        camera->geometry_broken = true;
+    }
+#endif
+
+    for (size_t i = 0; i < count; ++i) {
+        const SDL_Vertex *vertices = camera->fill_vertices + i * 3;
+        const SDL_Color color = vertices[0].color;
+
+        if (SDL_SetRenderDrawColor(camera->renderer, color.r, color.g, color.b, color.a) < 0) {
+            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        if (fill_triangle(
+                camera->renderer,
+                triangle(
+                    vec(vertices[0].position.x, vertices[0].position.y),
+                    vec(vertices[1].position.x, vertices[1].position.y),
+                    vec(vertices[2].position.x, vertices[2].position.y))) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int camera_flush(Camera *camera)
+{
+    trace_assert(camera);
+
+    if (camera_flush_rects(camera) < 0
+        || camera_flush_triangles(camera) < 0) {
+        return -1;
+    }
+
+    return 0;
 }
 
 /* ---------- Private Function ---------- */
 
+static SDL_Color camera_fill_color(const Camera *camera, Color color)
+{
+    trace_assert(camera);
+
+    SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
+    if (camera->debug_mode) {
+        sdl_color.a /= 2;
+    }
+
+    return sdl_color;
+}
+
+// Whether `rect` overlaps a recorded rect of another color. It has to
+// be drawn on top of that rect, which drawing the rects color by color
+// does not guarantee.
+static bool camera_fill_rect_blocked(const Camera *camera,
+                                     const SDL_Rect *rect,
+                                     SDL_Color color)
+{
+    trace_assert(camera);
+    trace_assert(rect);
+
+    // The runs of the same color as `rect` are skipped as a whole
+    for (size_t i = camera->fill_count; i > 0;) {
+        const size_t j = i - 1;
+        if (sdl_colors_equal(camera->fill_colors[j], color)) {
+            i = camera->fill_runs[j];
+        } else if (sdl_rects_overlap(&camera->fill_rects[j], rect)) {
+            return true;
+        } else {
+            i = j;
+        }
+    }
+
+    return false;
+}
+
+static int camera_record_fill_rect(Camera *camera,
+                                   SDL_Rect rect,
+                                   Color color)
+{
+    trace_assert(camera);
+
+    const SDL_Color sdl_color = camera_fill_color(camera, color);
+
+    if ((camera->fill_count >= CAMERA_FILL_RECTS_CAPACITY
+         || camera->fill_triangles_count > 0
+         || camera_fill_rect_blocked(camera, &rect, sdl_color))
+        && camera_flush(camera) < 0) {
+        return -1;
+    }
+
+    const size_t i = camera->fill_count++;
+    camera->fill_rects[i] = rect;
+    camera->fill_colors[i] = sdl_color;
+    camera->fill_runs[i] =
+        i > 0 && sdl_colors_equal(camera->fill_colors[i - 1], sdl_color)
+        ? camera->fill_runs[i - 1]
+        : i;
+
+    return 0;
+}
+
 static Vec effective_ratio(const SDL_Rect *view_port)
 {
     if ((float) view_port->w / RATIO_X > (float) view_port->h / RATIO_Y) {
@@ -350,19 +612,32 @@ static Vec effective_scale(const SDL_Rect *view_port)
         vec_scala_mult(effective_ratio(view_port), 50.0f));
 }
 
-Vec camera_point(const Camera *camera, const Vec p)
+static void camera_update_view_port(Camera *camera)
 {
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
+    trace_assert(camera);
+
+    SDL_RenderGetViewport(camera->renderer, &camera->screen_view_port);
+
+    const SDL_Rect *screen = &camera->screen_view_port;
+    const Vec s = effective_scale(screen);
+    camera->effective_scale = s;
+
+    camera->transform_scale = vec_scala_mult(s, camera->scale);
+    camera->transform_offset = vec_sum(
+        vec((float) screen->w * 0.5f,
+            (float) screen->h * 0.5f),
+        vec_neg(vec_entry_mult(camera->position, camera->transform_scale)));
 
-    return vec_sum(
-        vec_scala_mult(
-            vec_entry_mult(
-                vec_sum(p, vec_neg(camera->position)),
-                effective_scale(&view_port)),
-            camera->scale),
-        vec((float) view_port.w * 0.5f,
-            (float) view_port.h * 0.5f));
+    // Whatever is mapped to the corners of the screen
+    camera->view_port = rect_from_points(
+        camera_map_screen(camera, 0, 0),
+        camera_map_screen(camera, screen->w, screen->h));
+}
+
+Vec camera_point(const Camera *camera, const Vec p)
+{
+    return vec(p.x * camera->transform_scale.x + camera->transform_offset.x,
+               p.y * camera->transform_scale.y + camera->transform_offset.y);
 }
 
 static Triangle camera_triangle(const Camera *camera,
@@ -407,25 +682,8 @@ Vec camera_map_screen(const Camera *camera,
 {
     trace_assert(camera);
 
-    SDL_Rect view_port;
-    SDL_RenderGetViewport(camera->renderer, &view_port);
-
-    Vec es = effective_scale(&view_port);
-    es.x = 1.0f / es.x;
-    es.y = 1.0f / es.y;
-
-    const Vec p = vec((float) x, (float) y);
-
-    return vec_sum(
-        vec_entry_mult(
-            vec_scala_mult(
-                vec_sum(
-                    p,
-                    vec((float) view_port.w * -0.5f,
-                        (float) view_port.h * -0.5f)),
-                1.0f / camera->scale),
-            es),
-        camera->position);
+    return vec(((float) x - camera->transform_offset.x) / camera->transform_scale.x,
+               ((float) y - camera->transform_offset.y) / camera->transform_scale.y);
 }
 
 int camera_fill_rect_screen(Camera *camera,
@@ -434,28 +692,7 @@ int camera_fill_rect_screen(Camera *camera,
 {
     trace_assert(camera);
 
-    const SDL_Rect sdl_rect = rect_for_sdl(rect);
-    const SDL_Color sdl_color = color_for_sdl(camera->blackwhite_mode ? color_desaturate(color) : color);
-
-    if (camera->debug_mode) {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a / 2) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    } else {
-        if (SDL_SetRenderDrawColor(camera->renderer, sdl_color.r, sdl_color.g, sdl_color.b, sdl_color.a) < 0) {
-            log_fail("SDL_SetRenderDrawColor: %s\n", SDL_GetError());
-            return -1;
-        }
-    }
-
-    if (SDL_RenderFillRect(camera->renderer, &sdl_rect) < 0) {
-        log_fail("SDL_RenderFillRect: %s\n", SDL_GetError());
-        return -1;
-    }
-
-    return 0;
-
+    return camera_record_fill_rect(camera, rect_for_sdl(rect), color);
 }
 
 int camera_render_text_screen(Camera *camera,
@@ -463,17 +700,33 @@ int camera_render_text_screen(Camera *camera,
                               Vec size,
                               Color color,
                               Vec position)
+{
+    return camera_render_text_screen_with_offsets(
+        camera, text, size, color, position, NULL);
+}
+
+int camera_render_text_screen_with_offsets(Camera *camera,
+                                           const char *text,
+                                           Vec size,
+                                           Color color,
+                                           Vec position,
+                                           const Vec *offsets)
 {
     trace_assert(camera);
     trace_assert(text);
 
-    return sprite_font_render_text(
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
+    return sprite_font_render_text_with_offsets(
         camera->font,
         camera->renderer,
         position,
         size,
         color,
-        text);
+        text,
+        offsets);
 }
 
 int camera_draw_thicc_rect_screen(Camera *camera,
@@ -539,6 +792,112 @@ const Sprite_font *camera_font(const Camera *camera)
     return camera->font;
 }
 
+SDL_Renderer *camera_renderer(const Camera *camera)
+{
+    trace_assert(camera);
+    return camera->renderer;
+}
+
+bool camera_is_debug_mode(const Camera *camera)
+{
+    trace_assert(camera);
+    return camera->debug_mode;
+}
+
+bool camera_is_blackwhite_mode(const Camera *camera)
+{
+    trace_assert(camera);
+    return camera->blackwhite_mode;
+}
+
+Vec camera_pixels_per_unit(const Camera *camera)
+{
+    trace_assert(camera);
+    return camera->transform_scale;
+}
+
+int camera_begin_texture(Camera *camera,
+                         SDL_Texture *texture,
+                         Rect area)
+{
+    trace_assert(camera);
+    trace_assert(texture);
+
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
+    int w = 0, h = 0;
+    if (SDL_QueryTexture(texture, NULL, NULL, &w, &h) < 0) {
+        log_fail("SDL_QueryTexture: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    if (SDL_SetRenderTarget(camera->renderer, texture) < 0) {
+        log_fail("SDL_SetRenderTarget: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    // The texture is blended when it's drawn, so whatever is drawn
+    // into it replaces the pixels rather than blends with them
+    if (SDL_SetRenderDrawBlendMode(camera->renderer, SDL_BLENDMODE_NONE) < 0
+        || SDL_SetRenderDrawColor(camera->renderer, 0, 0, 0, 0) < 0
+        || SDL_RenderClear(camera->renderer) < 0) {
+        log_fail("Could not clear the texture: %s\n", SDL_GetError());
+        camera_end_texture(camera);
+        return -1;
+    }
+
+    camera->screen_view_port = (SDL_Rect) {0, 0, w, h};
+    camera->view_port = area;
+    camera->transform_scale = vec((float) w / area.w, (float) h / area.h);
+    camera->transform_offset = vec(-area.x * camera->transform_scale.x,
+                                   -area.y * camera->transform_scale.y);
+
+    return 0;
+}
+
+int camera_end_texture(Camera *camera)
+{
+    trace_assert(camera);
+
+    int result = camera_flush(camera);
+
+    if (SDL_SetRenderTarget(camera->renderer, NULL) < 0) {
+        log_fail("SDL_SetRenderTarget: %s\n", SDL_GetError());
+        result = -1;
+    }
+
+    if (SDL_SetRenderDrawBlendMode(camera->renderer, SDL_BLENDMODE_BLEND) < 0) {
+        log_fail("SDL_SetRenderDrawBlendMode: %s\n", SDL_GetError());
+        result = -1;
+    }
+
+    camera_update_view_port(camera);
+
+    return result;
+}
+
+int camera_render_texture_screen(Camera *camera,
+                                 SDL_Texture *texture,
+                                 Rect rect)
+{
+    trace_assert(camera);
+    trace_assert(texture);
+
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
+    const SDL_Rect dest = rect_for_sdl(rect);
+    if (SDL_RenderCopy(camera->renderer, texture, NULL, &dest) < 0) {
+        log_fail("SDL_RenderCopy: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
+
 Rect camera_text_boundary_box(const Camera *camera,
                               Vec position,
                               Vec scale,
@@ -1,6 +1,8 @@
 #ifndef CAMERA_H_
 #define CAMERA_H_
 
+#include <stdbool.h>
+
 #include "color.h"
 #include "game/sprite_font.h"
 #include "math/point.h"
@@ -16,6 +18,9 @@ void destroy_camera(Camera *camera);
 int camera_clear_background(Camera *camera,
                             Color color);
 
+// Only records the rect. The recorded rects are drawn grouped by
+// their color on camera_flush() or before anything else is drawn
+// through the camera.
 int camera_fill_rect(Camera *camera,
                      Rect rect,
                      Color color);
@@ -37,6 +42,8 @@ int camera_draw_triangle(Camera *camera,
                          Triangle t,
                          Color color);
 
+// Records the triangle like camera_fill_rect(). The recorded
+// triangles are drawn with a single SDL_RenderGeometry().
 int camera_fill_triangle(Camera *camera,
                          Triangle t,
                          Color color);
@@ -52,6 +59,13 @@ int camera_render_text_screen(Camera *camera,
                               Vec size,
                               Color color,
                               Vec position);
+// See sprite_font_render_text_with_offsets()
+int camera_render_text_screen_with_offsets(Camera *camera,
+                                           const char *text,
+                                           Vec size,
+                                           Color color,
+                                           Vec position,
+                                           const Vec *offsets);
 
 Rect camera_text_boundary_box(const Camera *camera,
                               Vec position,
@@ -80,8 +94,20 @@ int camera_is_text_visible(const Camera *camera,
                            Vec position,
                            const char *text);
 
+// The part of the world visible through the camera
 Rect camera_view_port(const Camera *camera);
 
+// Must be called before rendering a frame. Resets the culling
+// counters.
+void camera_begin_frame(Camera *camera);
+// Whether `rect` can be seen through the camera. Counts the rect as
+// drawn or culled for camera_render_culling_stats().
+bool camera_is_rect_visible(Camera *camera, Rect rect);
+// Counts the objects that were culled without
+// camera_is_rect_visible()
+void camera_count_culled(Camera *camera, size_t drawn, size_t culled);
+int camera_render_culling_stats(Camera *camera);
+
 Rect camera_view_port_screen(const Camera *camera);
 
 Vec camera_map_screen(const Camera *camera,
@@ -90,10 +116,35 @@ Vec camera_map_screen(const Camera *camera,
 Vec camera_point(const Camera *camera, const Vec p);
 Rect camera_rect(const Camera *camera, const Rect rect);
 
+// Records the rect like camera_fill_rect()
 int camera_fill_rect_screen(Camera *camera,
                             Rect rect,
                             Color color);
 
+// Draws the recorded rects. Must be called before drawing with the
+// renderer directly and before presenting the frame.
+int camera_flush(Camera *camera);
+
 const Sprite_font *camera_font(const Camera *camera);
+SDL_Renderer *camera_renderer(const Camera *camera);
+
+bool camera_is_debug_mode(const Camera *camera);
+bool camera_is_blackwhite_mode(const Camera *camera);
+// How many pixels of the screen a unit of the world takes
+Vec camera_pixels_per_unit(const Camera *camera);
+
+// Redirects everything drawn through the camera into the target
+// `texture` that shows the `area` of the world until
+// camera_end_texture(). The texture is cleared first and the drawing
+// is not blended.
+int camera_begin_texture(Camera *camera,
+                         SDL_Texture *texture,
+                         Rect area);
+int camera_end_texture(Camera *camera);
+// Draws the `texture` over the `rect` of the screen. The texture is
+// not filtered if `rect` is in whole pixels and as big as the texture.
+int camera_render_texture_screen(Camera *camera,
+                                 SDL_Texture *texture,
+                                 Rect rect);
 
 #endif  // CAMERA_H_
@@ -17,6 +17,7 @@
 #include "game/level/regions.h"
 #include "game/level/rigid_bodies.h"
 #include "game/level_metadata.h"
+#include "game/replay.h"
 #include "game/level/level_editor/rect_layer.h"
 #include "game/level/level_editor/point_layer.h"
 #include "game/level/level_editor/player_layer.h"
@@ -48,6 +49,10 @@ struct Level
     Regions *regions;
     Broadcast *broadcast;
     Script *supa_script;
+    ReplayWriter *replay_writer;
+    // The move or the stop the player holds. It is applied on every
+    // update, so repeating it with level_act() changes nothing.
+    LevelAction move;
 };
 
 Level *create_level_from_level_editor(const LevelEditor *level_editor,
@@ -75,7 +80,10 @@ Level *create_level_from_level_editor(const LevelEditor *level_editor,
         RETURN_LT(lt, NULL);
     }
 
-    level->rigid_bodies = PUSH_LT(lt, create_rigid_bodies(1024), destroy_rigid_bodies);
+    level->rigid_bodies = PUSH_LT(
+        lt,
+        create_rigid_bodies(1024, BROADPHASE_UNIFORM_GRID),
+        destroy_rigid_bodies);
     if (level->rigid_bodies == NULL) {
         RETURN_LT(lt, NULL);
     }
@@ -170,6 +178,17 @@ void destroy_level(Level *level)
 }
 
 
+void level_before_render(Level *level, Camera *camera, float alpha)
+{
+    trace_assert(level);
+    trace_assert(camera);
+
+    rigid_bodies_interpolate(level->rigid_bodies, alpha);
+    // The camera follows the player where it is rendered rather than
+    // where it was after the last physics step
+    player_focus_camera(level->player, camera);
+}
+
 int level_render(const Level *level, Camera *camera)
 {
     trace_assert(level);
@@ -210,6 +229,14 @@ int level_render(const Level *level, Camera *camera)
         return -1;
     }
 
+    if (rigid_bodies_render_stats(level->rigid_bodies, camera) < 0) {
+        return -1;
+    }
+
+    if (camera_render_culling_stats(camera) < 0) {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -218,10 +245,25 @@ int level_update(Level *level, float delta_time)
     trace_assert(level);
     trace_assert(delta_time > 0);
 
+    switch (level->move) {
+    case LEVEL_ACTION_STOP:
+        player_stop(level->player);
+        break;
+    case LEVEL_ACTION_MOVE_LEFT:
+        player_move_left(level->player);
+        break;
+    case LEVEL_ACTION_MOVE_RIGHT:
+        player_move_right(level->player);
+        break;
+    case LEVEL_ACTION_JUMP:
+        trace_assert(0 && "A jump is never held");
+        break;
+    }
+
     boxes_float_in_lava(level->boxes, level->lava);
     rigid_bodies_apply_omniforce(level->rigid_bodies, vec(0.0f, LEVEL_GRAVITY));
 
-    boxes_update(level->boxes, delta_time);
+    rigid_bodies_integrate_all(level->rigid_bodies, delta_time);
     player_update(level->player, delta_time);
 
     rigid_bodies_collide(level->rigid_bodies, level->platforms);
@@ -247,14 +289,14 @@ int level_event(Level *level, const SDL_Event *event)
     case SDL_KEYDOWN:
         switch (event->key.keysym.sym) {
         case SDLK_SPACE: {
-            player_jump(level->player, level->supa_script);
+            return level_act(level, LEVEL_ACTION_JUMP);
         } break;
         }
         break;
 
     case SDL_JOYBUTTONDOWN:
         if (event->jbutton.button == 1) {
-            player_jump(level->player, level->supa_script);
+            return level_act(level, LEVEL_ACTION_JUMP);
         }
         break;
     }
@@ -271,20 +313,53 @@ int level_input(Level *level,
     (void) the_stick_of_joy;
 
     if (keyboard_state[SDL_SCANCODE_A]) {
-        player_move_left(level->player);
+        return level_act(level, LEVEL_ACTION_MOVE_LEFT);
     } else if (keyboard_state[SDL_SCANCODE_D]) {
-        player_move_right(level->player);
+        return level_act(level, LEVEL_ACTION_MOVE_RIGHT);
     } else if (the_stick_of_joy && SDL_JoystickGetAxis(the_stick_of_joy, 0) < 0) {
-        player_move_left(level->player);
+        return level_act(level, LEVEL_ACTION_MOVE_LEFT);
     } else if (the_stick_of_joy && SDL_JoystickGetAxis(the_stick_of_joy, 0) > 0) {
-        player_move_right(level->player);
-    } else {
-        player_stop(level->player);
+        return level_act(level, LEVEL_ACTION_MOVE_RIGHT);
+    }
+
+    return level_act(level, LEVEL_ACTION_STOP);
+}
+
+int level_act(Level *level, LevelAction action)
+{
+    trace_assert(level);
+
+    if (level->replay_writer != NULL
+        && replay_writer_action(level->replay_writer, action) < 0) {
+        return -1;
+    }
+
+    switch (action) {
+    case LEVEL_ACTION_STOP:
+    case LEVEL_ACTION_MOVE_LEFT:
+    case LEVEL_ACTION_MOVE_RIGHT:
+        level->move = action;
+        break;
+    case LEVEL_ACTION_JUMP:
+        player_jump(level->player, level->supa_script);
+        break;
     }
 
     return 0;
 }
 
+void level_record(Level *level, ReplayWriter *writer)
+{
+    trace_assert(level);
+    level->replay_writer = writer;
+}
+
+uint64_t level_checksum(const Level *level)
+{
+    trace_assert(level);
+    return rigid_bodies_checksum(level->rigid_bodies);
+}
+
 int level_sound(Level *level, Sound_samples *sound_samples)
 {
     if (goals_sound(level->goals, sound_samples) < 0) {
@@ -298,6 +373,12 @@ int level_sound(Level *level, Sound_samples *sound_samples)
     return 0;
 }
 
+int level_set_physics_threads(Level *level, size_t threads_count)
+{
+    trace_assert(level);
+    return rigid_bodies_set_island_threads(level->rigid_bodies, threads_count);
+}
+
 void level_toggle_debug_mode(Level *level)
 {
     background_toggle_debug_mode(level->background);
@@ -340,7 +421,14 @@ struct EvalResult level_send(Level *level, Gc *gc, struct Scope *scope, struct E
             return res;
         }
 
-        rigid_bodies_apply_force(level->rigid_bodies, (size_t) id, vec((float) x, (float) y));
+        if (!rigid_bodies_exists(level->rigid_bodies, (RigidBodyId) id)) {
+            return eval_failure(
+                CONS(gc,
+                     SYMBOL(gc, "no-such-body"),
+                     NUMBER(gc, id)));
+        }
+
+        rigid_bodies_apply_force(level->rigid_bodies, (RigidBodyId) id, vec((float) x, (float) y));
 
         return eval_success(NIL(gc));
     } else if (strcmp(target, "edit") == 0) {
@@ -2,6 +2,7 @@
 #define LEVEL_H_
 
 #include <SDL.h>
+#include <stdint.h>
 
 #include "game/camera.h"
 #include "game/level/platforms.h"
@@ -12,11 +13,25 @@
 typedef struct Broadcast Broadcast;
 typedef struct Level Level;
 typedef struct LevelEditor LevelEditor;
+typedef struct ReplayWriter ReplayWriter;
+
+// Everything the player can do to the level. The values are stored in
+// the replays, so the existing ones must not change.
+typedef enum {
+    LEVEL_ACTION_STOP = 0,
+    LEVEL_ACTION_MOVE_LEFT,
+    LEVEL_ACTION_MOVE_RIGHT,
+    LEVEL_ACTION_JUMP
+} LevelAction;
 
 Level *create_level_from_level_editor(const LevelEditor *level_editor,
                                       Broadcast *broadcast);
 void destroy_level(Level *level);
 
+// Moves the bodies and the camera to where the frame is rendered.
+// `alpha` is how far the frame is between the last two physics steps,
+// see rigid_bodies_interpolate()
+void level_before_render(Level *level, Camera *camera, float alpha);
 int level_render(const Level *level, Camera *camera);
 
 int level_sound(Level *level, Sound_samples *sound_samples);
@@ -28,6 +43,17 @@ int level_input(Level *level,
                 SDL_Joystick *the_stick_of_joy);
 int level_enter_camera_event(Level *level, Camera *camera);
 
+// level_event() and level_input() boil down to these. A move or a stop
+// holds until the next one and is applied on every level_update(), a
+// jump happens right away.
+int level_act(Level *level, LevelAction action);
+// Makes level_act() record all of the actions to `writer`. The writer
+// is not owned by the level. NULL stops the recording.
+void level_record(Level *level, ReplayWriter *writer);
+// See rigid_bodies_checksum()
+uint64_t level_checksum(const Level *level);
+
+int level_set_physics_threads(Level *level, size_t threads_count);
 void level_toggle_debug_mode(Level *level);
 void level_toggle_pause_mode(Level *level);
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdint.h>
 
 #include "game/level/background.h"
 #include "math/rand.h"
@@ -12,14 +13,43 @@
 #define BACKGROUND_CHUNK_COUNT 5
 #define BACKGROUND_CHUNK_WIDTH 250.0f
 #define BACKGROUND_CHUNK_HEIGHT 250.0f
+#define BACKGROUND_LAYER_COUNT 3
+
+typedef struct {
+    Rect rects[BACKGROUND_CHUNK_COUNT];
+} BackgroundChunk;
+
+// The chunks of a layer that were visible on the previous frame. The
+// chunk (x, y) is chunks[(x - min_x) * h + (y - min_y)]. When the
+// camera moves the chunks that are still visible are moved to the new
+// window and only the rest are generated.
+typedef struct {
+    int min_x, min_y;
+    int w, h;
+    BackgroundChunk *chunks;
+    // The next window is built here and swapped with `chunks`
+    BackgroundChunk *scratch;
+    size_t capacity;
+} BackgroundWindow;
+
+// The background is rendered through a const pointer, so the cache
+// lives behind one
+typedef struct {
+    BackgroundWindow windows[BACKGROUND_LAYER_COUNT];
+} BackgroundCache;
 
 static void chunk_of_point(Point p, int *x, int *y);
-int render_chunk(const Background *background,
-                 Camera *camera,
-                 int x, int y,
-                 Color color,
-                 Vec position,
-                 float parallax);
+static int background_window_update(BackgroundWindow *window,
+                                    Lt *lt,
+                                    int layer,
+                                    int min_x, int min_y,
+                                    int max_x, int max_y);
+static int render_chunk(const Background *background,
+                        Camera *camera,
+                        const BackgroundChunk *chunk,
+                        Color color,
+                        Vec position,
+                        float parallax);
 
 struct Background
 {
@@ -27,6 +57,7 @@ struct Background
     Color base_color;
     Vec position;
     int debug_mode;
+    BackgroundCache *cache;
 };
 
 Background *create_background(Color base_color)
@@ -38,6 +69,11 @@ Background *create_background(Color base_color)
         RETURN_LT(lt, NULL);
     }
 
+    background->cache = PUSH_LT(lt, nth_calloc(1, sizeof(BackgroundCache)), free);
+    if (background->cache == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
     background->base_color = base_color;
     background->position = vec(0.0f, 0.0f);
     background->debug_mode = 0;
@@ -79,7 +115,7 @@ int background_render(const Background *background,
     const Rect view_port = camera_view_port(camera);
     const Vec position = vec(view_port.x, view_port.y);
 
-    for (int l = 0; l < 3; ++l) {
+    for (int l = 0; l < BACKGROUND_LAYER_COUNT; ++l) {
         const float parallax = 1.0f - 0.2f * (float)l;
 
         int min_x = 0, min_y = 0;
@@ -92,17 +128,23 @@ int background_render(const Background *background,
                            view_port.y - position.y * parallax + view_port.h),
                        &max_x, &max_y);
 
-        for (int x = min_x; x <= max_x; ++x) {
-            for (int y = min_y; y <= max_y; ++y) {
-                if (render_chunk(
-                        background,
-                        camera,
-                        x, y,
-                        color_darker(background->base_color, 0.05f * (float)(l + 1)),
-                        position,
-                        parallax) < 0) {
-                    return -1;
-                }
+        BackgroundWindow *window = &background->cache->windows[l];
+        if (background_window_update(window, background->lt, l,
+                                     min_x, min_y, max_x, max_y) < 0) {
+            return -1;
+        }
+
+        const Color color = color_darker(background->base_color, 0.05f * (float)(l + 1));
+
+        for (int i = 0; i < window->w * window->h; ++i) {
+            if (render_chunk(
+                    background,
+                    camera,
+                    &window->chunks[i],
+                    color,
+                    position,
+                    parallax) < 0) {
+                return -1;
             }
         }
     }
@@ -120,35 +162,139 @@ static void chunk_of_point(Point p, int *x, int *y)
     *y = (int) (p.y / BACKGROUND_CHUNK_HEIGHT);
 }
 
-int render_chunk(const Background *background,
-                 Camera *camera,
-                 int chunk_x, int chunk_y,
-                 Color color,
-                 Vec position,
-                 float parallax)
+static uint64_t chunk_seed(int layer, int chunk_x, int chunk_y)
 {
-    (void) background;
+    return ((uint64_t) (uint32_t) chunk_x << 32 | (uint32_t) chunk_y)
+        ^ ((uint64_t) (uint32_t) layer * 0xD6E8FEB86659FD93ULL);
+}
 
-    if (background->debug_mode) {
+static void generate_chunk(BackgroundChunk *chunk,
+                           int layer,
+                           int chunk_x, int chunk_y)
+{
+    trace_assert(chunk);
+
+    LocalRand local = local_rand(chunk_seed(layer, chunk_x, chunk_y));
+
+    for (size_t i = 0; i < BACKGROUND_CHUNK_COUNT; ++i) {
+        const float rect_x = local_rand_float_range(
+            &local,
+            (float) chunk_x * BACKGROUND_CHUNK_WIDTH,
+            (float) (chunk_x + 1) * BACKGROUND_CHUNK_WIDTH);
+        const float rect_y = local_rand_float_range(
+            &local,
+            (float) chunk_y * BACKGROUND_CHUNK_HEIGHT,
+            (float) (chunk_y + 1) * BACKGROUND_CHUNK_HEIGHT);
+        const float rect_w = local_rand_float_range(
+            &local, 0.0f, BACKGROUND_CHUNK_WIDTH * 0.5f);
+        const float rect_h = local_rand_float_range(
+            &local, rect_w * 0.5f, rect_w * 1.5f);
+
+        chunk->rects[i] = rect(rect_x, rect_y, rect_w, rect_h);
+    }
+}
+
+// Reallocates the chunks of a window that may not be allocated yet.
+// Returns NULL on failure leaving `chunks` untouched.
+static BackgroundChunk *background_realloc_chunks(Lt *lt,
+                                                  BackgroundChunk *chunks,
+                                                  size_t capacity)
+{
+    trace_assert(lt);
+
+    BackgroundChunk *new_chunks = nth_realloc(chunks, capacity * sizeof(BackgroundChunk));
+    if (new_chunks == NULL) {
+        return NULL;
+    }
+
+    if (chunks == NULL) {
+        return PUSH_LT(lt, new_chunks, free);
+    }
+
+    return REPLACE_LT(lt, chunks, new_chunks);
+}
+
+// Makes the `window` of the `layer` hold the chunks
+// [min_x..max_x]x[min_y..max_y]. The chunks are allocated in `lt`.
+static int background_window_update(BackgroundWindow *window,
+                                    Lt *lt,
+                                    int layer,
+                                    int min_x, int min_y,
+                                    int max_x, int max_y)
+{
+    trace_assert(window);
+    const int w = max_x - min_x + 1;
+    const int h = max_y - min_y + 1;
+
+    if (window->min_x == min_x && window->min_y == min_y
+        && window->w == w && window->h == h) {
         return 0;
     }
 
-    srand((unsigned int)(roundf((float)chunk_x + (float)chunk_y + parallax)));
+    const size_t count = (size_t) w * (size_t) h;
+    if (count > window->capacity) {
+        BackgroundChunk *chunks = background_realloc_chunks(lt, window->chunks, count);
+        if (chunks == NULL) {
+            return -1;
+        }
+        window->chunks = chunks;
 
-    for (size_t i = 0; i < BACKGROUND_CHUNK_COUNT; ++i) {
-        const float rect_x = rand_float_range((float) chunk_x * BACKGROUND_CHUNK_WIDTH,
-                                              (float) (chunk_x + 1) * BACKGROUND_CHUNK_WIDTH);
-        const float rect_y = rand_float_range((float) chunk_y * BACKGROUND_CHUNK_HEIGHT,
-                                              (float) (chunk_y + 1) * BACKGROUND_CHUNK_HEIGHT);
-        const float rect_w = rand_float_range(0.0f, BACKGROUND_CHUNK_WIDTH * 0.5f);
-        const float rect_h = rand_float_range(rect_w * 0.5f, rect_w * 1.5f);
+        BackgroundChunk *scratch = background_realloc_chunks(lt, window->scratch, count);
+        if (scratch == NULL) {
+            return -1;
+        }
+        window->scratch = scratch;
+
+        window->capacity = count;
+    }
+
+    for (int x = min_x; x <= max_x; ++x) {
+        for (int y = min_y; y <= max_y; ++y) {
+            BackgroundChunk *chunk = &window->scratch[(x - min_x) * h + (y - min_y)];
+
+            if (window->min_x <= x && x < window->min_x + window->w
+                && window->min_y <= y && y < window->min_y + window->h) {
+                *chunk = window->chunks[(x - window->min_x) * window->h + (y - window->min_y)];
+            } else {
+                generate_chunk(chunk, layer, x, y);
+            }
+        }
+    }
 
+    BackgroundChunk *chunks = window->chunks;
+    window->chunks = window->scratch;
+    window->scratch = chunks;
+
+    window->min_x = min_x;
+    window->min_y = min_y;
+    window->w = w;
+    window->h = h;
+
+    return 0;
+}
+
+static int render_chunk(const Background *background,
+                        Camera *camera,
+                        const BackgroundChunk *chunk,
+                        Color color,
+                        Vec position,
+                        float parallax)
+{
+    trace_assert(background);
+    trace_assert(camera);
+    trace_assert(chunk);
+
+    if (background->debug_mode) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < BACKGROUND_CHUNK_COUNT; ++i) {
         if (camera_fill_rect(
                 camera,
-                rect(rect_x + position.x * parallax,
-                     rect_y + position.y * parallax,
-                     rect_w,
-                     rect_h),
+                rect(chunk->rects[i].x + position.x * parallax,
+                     chunk->rects[i].y + position.y * parallax,
+                     chunk->rects[i].w,
+                     chunk->rects[i].h),
                 color) < 0) {
             return -1;
         }
@@ -54,6 +54,9 @@ Boxes *create_boxes_from_rect_layer(const RectLayer *layer, RigidBodies *rigid_b
 
     for (size_t i = 0; i < count; ++i) {
         RigidBodyId body_id = rigid_bodies_add(rigid_bodies, rects[i]);
+        if (body_id == RIGID_BODIES_NO_ID) {
+            RETURN_LT(lt, NULL);
+        }
         dynarray_push(boxes->body_ids, &body_id);
         dynarray_push(boxes->body_colors, &colors[i]);
     }
@@ -97,34 +100,16 @@ int boxes_render(Boxes *boxes, Camera *camera)
     return 0;
 }
 
-int boxes_update(Boxes *boxes,
-                 float delta_time)
-{
-    trace_assert(boxes);
-
-    const size_t count = dynarray_count(boxes->body_ids);
-    RigidBodyId *body_ids = dynarray_data(boxes->body_ids);
-
-    for (size_t i = 0; i < count; ++i) {
-        if (rigid_bodies_update(boxes->rigid_bodies, body_ids[i], delta_time) < 0) {
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
 void boxes_float_in_lava(Boxes *boxes, Lava *lava)
 {
     trace_assert(boxes);
     trace_assert(lava);
 
-    const size_t count = dynarray_count(boxes->body_ids);
-    RigidBodyId *body_ids = dynarray_data(boxes->body_ids);
-
-    for (size_t i = 0; i < count; ++i) {
-        lava_float_rigid_body(lava, boxes->rigid_bodies, body_ids[i]);
-    }
+    lava_float_rigid_bodies(
+        lava,
+        boxes->rigid_bodies,
+        dynarray_data(boxes->body_ids),
+        dynarray_count(boxes->body_ids));
 }
 
 int boxes_add_box(Boxes *boxes, Rect rect, Color color)
@@ -132,6 +117,9 @@ int boxes_add_box(Boxes *boxes, Rect rect, Color color)
     trace_assert(boxes);
 
     RigidBodyId body_id = rigid_bodies_add(boxes->rigid_bodies, rect);
+    if (body_id == RIGID_BODIES_NO_ID) {
+        return -1;
+    }
     dynarray_push(boxes->body_ids, &body_id);
     dynarray_push(boxes->body_colors, &color);
 
@@ -170,7 +158,9 @@ boxes_send(Boxes *boxes, Gc *gc, struct Scope *scope, struct Expr path)
                 color = hexstr(color_hex);
             }
 
-            boxes_add_box(boxes, rect((float) x, (float) y, (float) w, (float) h), color);
+            if (boxes_add_box(boxes, rect((float) x, (float) y, (float) w, (float) h), color) < 0) {
+                return eval_failure(STRING(gc, "Could not add a box"));
+            }
 
             return eval_success(NIL(gc));
         }
@@ -16,7 +16,6 @@ Boxes *create_boxes_from_rect_layer(const RectLayer *layer, RigidBodies *rigid_b
 void destroy_boxes(Boxes *boxes);
 
 int boxes_render(Boxes *boxes, Camera *camera);
-int boxes_update(Boxes *boxes, float delta_time);
 
 void boxes_float_in_lava(Boxes *boxes, Lava *lava);
 
@@ -11,15 +11,45 @@
 #include "system/nth_alloc.h"
 #include "system/log.h"
 #include "game/level/level_editor/rect_layer.h"
+#include "game/level/platforms/bvh.h"
 
 #define LAVA_BOINGNESS 2500.0f
+// How far the waves of the lava may stick out of its hitbox
+#define LAVA_WAVES_MARGIN 10.0f
 
 struct Lava {
     Lt *lt;
     size_t rects_count;
     Wavy_rect **rects;
+
+    // The hitboxes of the rects never change, so they are indexed
+    // only once
+    Rect *hitboxes;
+    Bvh *bvh;
 };
 
+static int lava_index_rects(Lava *lava, Lt *lt)
+{
+    trace_assert(lava);
+    trace_assert(lt);
+
+    lava->hitboxes = PUSH_LT(lt, nth_calloc(lava->rects_count, sizeof(Rect)), free);
+    if (lava->hitboxes == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < lava->rects_count; ++i) {
+        lava->hitboxes[i] = wavy_rect_hitbox(lava->rects[i]);
+    }
+
+    lava->bvh = PUSH_LT(lt, create_bvh(lava->hitboxes, lava->rects_count), destroy_bvh);
+    if (lava->bvh == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
 Lava *create_lava_from_line_stream(LineStream *line_stream)
 {
     trace_assert(line_stream);
@@ -51,6 +81,10 @@ Lava *create_lava_from_line_stream(LineStream *line_stream)
         }
     }
 
+    if (lava_index_rects(lava, lt) < 0) {
+        RETURN_LT(lt, NULL);
+    }
+
     lava->lt = lt;
 
     return lava;
@@ -81,6 +115,10 @@ Lava *create_lava_from_rect_layer(const RectLayer *rect_layer)
         }
     }
 
+    if (lava_index_rects(lava, lt) < 0) {
+        RETURN_LT(lt, NULL);
+    }
+
     return lava;
 }
 
@@ -97,12 +135,20 @@ int lava_render(const Lava *lava,
     trace_assert(lava);
     trace_assert(camera);
 
-    for (size_t i = 0; i < lava->rects_count; ++i) {
+    const Rect view_port = rect_scale(camera_view_port(camera), LAVA_WAVES_MARGIN);
+    size_t drawn = 0;
+
+    for (size_t i = bvh_next_overlap(lava->bvh, view_port, 0);
+         i < lava->rects_count;
+         i = bvh_next_overlap(lava->bvh, view_port, i + 1)) {
         if (wavy_rect_render(lava->rects[i], camera) < 0) {
             return -1;
         }
+        drawn++;
     }
 
+    camera_count_culled(camera, drawn, lava->rects_count - drawn);
+
     return 0;
 }
 
@@ -124,30 +170,44 @@ bool lava_overlaps_rect(const Lava *lava,
 {
     trace_assert(lava);
 
-    for (size_t i = 0; i < lava->rects_count; ++i) {
-        if (rects_overlap(wavy_rect_hitbox(lava->rects[i]), rect)) {
-            return true;
-        }
-    }
-
-    return 0;
+    return bvh_next_overlap(lava->bvh, rect, 0) < lava->rects_count;
 }
 
-void lava_float_rigid_body(Lava *lava, RigidBodies *rigid_bodies, RigidBodyId id)
+void lava_float_rigid_bodies(const Lava *lava,
+                             RigidBodies *rigid_bodies,
+                             const RigidBodyId *ids,
+                             size_t count)
 {
     trace_assert(lava);
+    trace_assert(rigid_bodies);
+    trace_assert(ids || count == 0);
+
+    for (size_t j = 0; j < count; ++j) {
+        const Rect object_hitbox = rigid_bodies_hitbox(rigid_bodies, ids[j]);
+
+        // The damping is proportional to the velocity that does not
+        // change until the next update, so the damping of all of the
+        // overlapping lava is applied at once
+        float buoyancy = 0.0f;
+        size_t overlaps_count = 0;
+
+        for (size_t i = bvh_next_overlap(lava->bvh, object_hitbox, 0);
+             i < lava->rects_count;
+             i = bvh_next_overlap(lava->bvh, object_hitbox, i + 1)) {
+            const Rect overlap_area = rects_overlap_area(object_hitbox, lava->hitboxes[i]);
+            buoyancy += overlap_area.w * overlap_area.h / (object_hitbox.w * object_hitbox.h);
+            overlaps_count++;
+        }
 
-    const Rect object_hitbox = rigid_bodies_hitbox(rigid_bodies, id);
-    for (size_t i = 0; i < lava->rects_count; ++i) {
-        const Rect lava_hitbox = wavy_rect_hitbox(lava->rects[i]);
-        if (rects_overlap(object_hitbox, lava_hitbox)) {
-            const Rect overlap_area = rects_overlap_area(object_hitbox, lava_hitbox);
-            const float k = overlap_area.w * overlap_area.h / (object_hitbox.w * object_hitbox.h);
+        if (overlaps_count > 0) {
             rigid_bodies_apply_force(
                 rigid_bodies,
-                id,
-                vec(0.0f, -k * LAVA_BOINGNESS));
-            rigid_bodies_damper(rigid_bodies, id, vec(0.0f, -0.9f));
+                ids[j],
+                vec(0.0f, -buoyancy * LAVA_BOINGNESS));
+            rigid_bodies_damper(
+                rigid_bodies,
+                ids[j],
+                vec(0.0f, -0.9f * (float) overlaps_count));
         }
     }
 }
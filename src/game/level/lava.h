@@ -21,6 +21,10 @@ int lava_update(Lava *lava, float delta_time);
 
 bool lava_overlaps_rect(const Lava *lava, Rect rect);
 
-void lava_float_rigid_body(Lava *lava, RigidBodies *rigid_bodies, RigidBodyId id);
+// Applies the buoyancy and the damping of the lava to the bodies
+void lava_float_rigid_bodies(const Lava *lava,
+                             RigidBodies *rigid_bodies,
+                             const RigidBodyId *ids,
+                             size_t count);
 
 #endif  // LAVA_H_
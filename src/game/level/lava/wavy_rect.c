@@ -2,9 +2,10 @@
 #include "system/stacktrace.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <math.h>
 
 #include "math/pi.h"
+#include "math/rand.h"
 #include "system/line_stream.h"
 #include "system/log.h"
 #include "system/lt.h"
@@ -12,6 +13,18 @@
 #include "wavy_rect.h"
 
 #define WAVE_PILLAR_WIDTH 10.0f
+// Every wavy rect has the same shape of the waves
+#define WAVE_SEED 42
+
+// The height of the pillar k is s * sin(angle + k) where s is the
+// random amplitude of the pillar. It is computed as
+// sin(angle) * (s * cos(k)) + cos(angle) * (s * sin(k)), so the
+// pillars need only their two products and the frame needs only one
+// sine and one cosine.
+typedef struct {
+    float cosine;
+    float sine;
+} WavePillar;
 
 struct Wavy_rect
 {
@@ -20,6 +33,9 @@ struct Wavy_rect
     Rect rect;
     Color color;
     float angle;
+
+    WavePillar *pillars;
+    size_t pillars_count;
 };
 
 Wavy_rect *create_wavy_rect(Rect rect, Color color)
@@ -36,6 +52,24 @@ Wavy_rect *create_wavy_rect(Rect rect, Color color)
     wavy_rect->angle = 0.0f;
     wavy_rect->lt = lt;
 
+    wavy_rect->pillars_count = rect.w > 0.0f
+        ? (size_t) ceilf(rect.w / WAVE_PILLAR_WIDTH)
+        : 0;
+    wavy_rect->pillars = PUSH_LT(
+        lt,
+        nth_calloc(wavy_rect->pillars_count + 1, sizeof(WavePillar)),
+        free);
+    if (wavy_rect->pillars == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    LocalRand local = local_rand(WAVE_SEED);
+    for (size_t k = 0; k < wavy_rect->pillars_count; ++k) {
+        const float s = (float) (local_rand_next(&local) % 50) * 0.1f;
+        wavy_rect->pillars[k].cosine = s * cosf((float) k);
+        wavy_rect->pillars[k].sine = s * sinf((float) k);
+    }
+
     return wavy_rect;
 }
 
@@ -72,24 +106,22 @@ int wavy_rect_render(const Wavy_rect *wavy_rect,
     trace_assert(wavy_rect);
     trace_assert(camera);
 
-    srand(42);
-    for (float wave_scanner = 0;
-         wave_scanner < wavy_rect->rect.w;
-         wave_scanner += WAVE_PILLAR_WIDTH) {
+    const float sine = sinf(wavy_rect->angle);
+    const float cosine = cosf(wavy_rect->angle);
 
-        const float s = (float) (rand() % 50) * 0.1f;
+    for (size_t k = 0; k < wavy_rect->pillars_count; ++k) {
+        const WavePillar *pillar = &wavy_rect->pillars[k];
         if (camera_fill_rect(
                 camera,
                 rect(
-                    wavy_rect->rect.x + wave_scanner,
-                    wavy_rect->rect.y + s * sinf(wavy_rect->angle + wave_scanner / WAVE_PILLAR_WIDTH),
+                    wavy_rect->rect.x + (float) k * WAVE_PILLAR_WIDTH,
+                    wavy_rect->rect.y + sine * pillar->cosine + cosine * pillar->sine,
                     WAVE_PILLAR_WIDTH * 1.20f,
                     wavy_rect->rect.h),
                 wavy_rect->color) < 0) {
             return -1;
         }
     }
-    srand((unsigned int) time(NULL));
 
     return 0;
 }
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <float.h>
+#include <math.h>
 
 #include "platforms.h"
 #include "system/lt.h"
@@ -11,6 +13,13 @@
 #include "system/nth_alloc.h"
 #include "system/log.h"
 #include "game/level/level_editor/rect_layer.h"
+#include "./platforms/bvh.h"
+#include "./platforms/tile_cache.h"
+
+// How deep platforms_sweep_rect() leaves the object inside of the
+// platform it hits, so platforms_snap_rect() and
+// platforms_touches_rect_sides() treat it as a regular contact
+#define PLATFORMS_SWEEP_PENETRATION 1.0f
 
 struct Platforms {
     Lt *lt;
@@ -18,6 +27,15 @@ struct Platforms {
     Rect *rects;
     Color *colors;
     size_t rects_size;
+
+    // Platforms never move, so the hierarchy is built only once
+    Bvh *bvh;
+    // ...and they can be drawn from the textures rendered once
+    TileCache *tile_cache;
+    // Half of the thinnest side among all of the platforms. An object
+    // that moves less than that per step can't pass through any of
+    // them.
+    float min_half_side;
 };
 
 Platforms *create_platforms_from_rect_layer(const RectLayer *layer)
@@ -50,6 +68,33 @@ Platforms *create_platforms_from_rect_layer(const RectLayer *layer)
     }
     memcpy(platforms->colors, rect_layer_colors(layer), sizeof(Color) * platforms->rects_size);
 
+    platforms->bvh = PUSH_LT(
+        lt,
+        create_bvh(platforms->rects, platforms->rects_size),
+        destroy_bvh);
+    if (platforms->bvh == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    platforms->tile_cache = PUSH_LT(
+        lt,
+        create_tile_cache(
+            platforms->rects,
+            platforms->colors,
+            platforms->rects_size,
+            platforms->bvh),
+        destroy_tile_cache);
+    if (platforms->tile_cache == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    platforms->min_half_side = FLT_MAX;
+    for (size_t i = 0; i < platforms->rects_size; ++i) {
+        platforms->min_half_side = fminf(
+            platforms->min_half_side,
+            fminf(platforms->rects[i].w, platforms->rects[i].h) * 0.5f);
+    }
+
     return platforms;
 }
 
@@ -63,15 +108,37 @@ void destroy_platforms(Platforms *platforms)
 int platforms_render(const Platforms *platforms,
                      Camera *camera)
 {
-    for (size_t i = 0; i < platforms->rects_size; ++i) {
+    trace_assert(platforms);
+    trace_assert(camera);
+
+    if (tile_cache_covers(platforms->tile_cache, camera)) {
+        if (tile_cache_render(platforms->tile_cache, camera) == 0) {
+            return 0;
+        }
+
+        // Drawing the platforms directly is always an option
+        log_warn("Could not render the platforms from the tiles\n");
+    }
+
+    // The platforms are visited in the order of their indices, so the
+    // overlapping ones are drawn in the same order as before
+    const Rect view_port = camera_view_port(camera);
+    size_t drawn = 0;
+
+    for (size_t i = bvh_next_overlap(platforms->bvh, view_port, 0);
+         i < platforms->rects_size;
+         i = bvh_next_overlap(platforms->bvh, view_port, i + 1)) {
         if (camera_fill_rect(
                 camera,
                 platforms->rects[i],
                 platforms->colors[i]) < 0) {
             return -1;
         }
+        drawn++;
     }
 
+    camera_count_culled(camera, drawn, platforms->rects_size - drawn);
+
     return 0;
 }
 
@@ -81,7 +148,9 @@ void platforms_touches_rect_sides(const Platforms *platforms,
 {
     trace_assert(platforms);
 
-    for (size_t i = 0; i < platforms->rects_size; ++i) {
+    for (size_t i = bvh_next_overlap(platforms->bvh, object, 0);
+         i < platforms->rects_size;
+         i = bvh_next_overlap(platforms->bvh, object, i + 1)) {
         rect_object_impact(object, platforms->rects[i], sides);
     }
 }
@@ -92,11 +161,112 @@ Vec platforms_snap_rect(const Platforms *platforms,
     trace_assert(platforms);
 
     Vec result = vec(1.0f, 1.0f);
-    for (size_t i = 0; i < platforms->rects_size; ++i) {
-        if (rects_overlap(platforms->rects[i], *object)) {
-            result = vec_entry_mult(result, rect_snap(platforms->rects[i], object));
-        }
+    // The object moves after every snap, so the next overlap is
+    // looked up for its new position. The platforms are still visited
+    // in the same order as a linear scan would.
+    for (size_t i = bvh_next_overlap(platforms->bvh, *object, 0);
+         i < platforms->rects_size;
+         i = bvh_next_overlap(platforms->bvh, *object, i + 1)) {
+        result = vec_entry_mult(result, rect_snap(platforms->rects[i], object));
     }
 
     return result;
 }
+
+// The times at which `object` moving by `d` starts and stops
+// overlapping `obstacle` along one axis, in the fractions of `d`
+static void platforms_sweep_axis(float object, float object_size,
+                                 float obstacle, float obstacle_size,
+                                 float d,
+                                 float *entry, float *exit)
+{
+    if (d > 0.0f) {
+        *entry = (obstacle - (object + object_size)) / d;
+        *exit = (obstacle + obstacle_size - object) / d;
+    } else if (d < 0.0f) {
+        *entry = (obstacle + obstacle_size - object) / d;
+        *exit = (obstacle - (object + object_size)) / d;
+    } else if (object + object_size > obstacle && obstacle + obstacle_size > object) {
+        *entry = -FLT_MAX;
+        *exit = FLT_MAX;
+    } else {
+        *entry = FLT_MAX;
+        *exit = -FLT_MAX;
+    }
+}
+
+bool platforms_sweep_rect(const Platforms *platforms,
+                          Rect *object,
+                          Vec displacement)
+{
+    trace_assert(platforms);
+    trace_assert(object);
+
+    if (fabsf(displacement.x) <= platforms->min_half_side
+        && fabsf(displacement.y) <= platforms->min_half_side) {
+        return false;
+    }
+
+    const Rect end = rect(object->x + displacement.x,
+                          object->y + displacement.y,
+                          object->w, object->h);
+    const Rect area = rect_boundary2(*object, end);
+
+    float hit_time = 1.0f;
+    size_t hit = platforms->rects_size;
+    bool hit_horizontal = false;
+
+    for (size_t i = bvh_next_overlap(platforms->bvh, area, 0);
+         i < platforms->rects_size;
+         i = bvh_next_overlap(platforms->bvh, area, i + 1)) {
+        const Rect p = platforms->rects[i];
+
+        float entry_x, exit_x, entry_y, exit_y;
+        platforms_sweep_axis(object->x, object->w, p.x, p.w, displacement.x, &entry_x, &exit_x);
+        platforms_sweep_axis(object->y, object->h, p.y, p.h, displacement.y, &entry_y, &exit_y);
+
+        const float entry = fmaxf(entry_x, entry_y);
+        const float exit = fminf(exit_x, exit_y);
+
+        // The platforms the object already overlaps are left to
+        // platforms_snap_rect()
+        if (entry < 0.0f || entry >= exit || entry >= hit_time) {
+            continue;
+        }
+
+        hit_time = entry;
+        hit = i;
+        hit_horizontal = entry_x > entry_y;
+    }
+
+    if (hit == platforms->rects_size) {
+        return false;
+    }
+
+    // If the object stops before the middle of the platform
+    // platforms_snap_rect() pushes it back the way it came from.
+    // Otherwise it would be pushed through.
+    const Rect p = platforms->rects[hit];
+    const Vec p_c = rect_center(p);
+    const Vec start_c = rect_center(*object);
+    const Vec end_c = rect_center(end);
+    const bool crossed = hit_horizontal
+        ? (start_c.x < p_c.x) != (end_c.x < p_c.x)
+        : (start_c.y < p_c.y) != (end_c.y < p_c.y);
+    if (!crossed) {
+        return false;
+    }
+
+    object->x += displacement.x * hit_time;
+    object->y += displacement.y * hit_time;
+
+    if (hit_horizontal) {
+        const float depth = fminf(PLATFORMS_SWEEP_PENETRATION, p.w * 0.25f);
+        object->x += displacement.x > 0.0f ? depth : -depth;
+    } else {
+        const float depth = fminf(PLATFORMS_SWEEP_PENETRATION, p.h * 0.25f);
+        object->y += displacement.y > 0.0f ? depth : -depth;
+    }
+
+    return true;
+}
@@ -2,6 +2,7 @@
 #define PLATFORMS_H_
 
 #include <SDL.h>
+#include <stdbool.h>
 
 #include "game/camera.h"
 #include "math/rect.h"
@@ -22,4 +23,13 @@ void platforms_touches_rect_sides(const Platforms *platforms,
 Vec platforms_snap_rect(const Platforms *platforms,
                         Rect *object);
 
+// Continuous collision for the objects that move too fast for
+// platforms_snap_rect(). If `object` moving by `displacement` from its
+// current position passes the middle of a platform, it is moved to
+// where it hits that platform, slightly inside of it. Returns false
+// and leaves `object` alone otherwise.
+bool platforms_sweep_rect(const Platforms *platforms,
+                          Rect *object,
+                          Vec displacement);
+
 #endif  // PLATFORMS_H_
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./bvh.h"
+
+#define BVH_LEAF_SIZE 4
+// Median splits keep the depth around log2(count / BVH_LEAF_SIZE)
+#define BVH_STACK_SIZE 64
+
+typedef struct {
+    Rect bbox;
+    // Range of the rect indices within the subtree. Used to skip the
+    // subtrees that can't contain the next overlap.
+    size_t min_id, max_id;
+    // Leaf if count > 0, otherwise an inner node with two children
+    size_t begin, count;
+    size_t left, right;
+} BvhNode;
+
+typedef struct {
+    size_t id;
+    float key;
+} BvhKey;
+
+struct Bvh
+{
+    Lt *lt;
+
+    const Rect *rects;
+    size_t rects_count;
+
+    size_t *ids;
+    BvhKey *keys;
+
+    BvhNode *nodes;
+    size_t nodes_count;
+};
+
+static int compare_keys(const void *a, const void *b)
+{
+    const BvhKey *ka = a;
+    const BvhKey *kb = b;
+
+    if (ka->key < kb->key) return -1;
+    if (ka->key > kb->key) return 1;
+    if (ka->id < kb->id) return -1;
+    if (ka->id > kb->id) return 1;
+    return 0;
+}
+
+static size_t bvh_build(Bvh *bvh, size_t begin, size_t count)
+{
+    trace_assert(bvh);
+    trace_assert(count > 0);
+
+    const size_t index = bvh->nodes_count++;
+    BvhNode *node = &bvh->nodes[index];
+
+    node->bbox = bvh->rects[bvh->ids[begin]];
+    node->min_id = bvh->ids[begin];
+    node->max_id = bvh->ids[begin];
+    for (size_t i = begin + 1; i < begin + count; ++i) {
+        const size_t id = bvh->ids[i];
+        node->bbox = rect_boundary2(node->bbox, bvh->rects[id]);
+        if (id < node->min_id) node->min_id = id;
+        if (id > node->max_id) node->max_id = id;
+    }
+
+    if (count <= BVH_LEAF_SIZE) {
+        node->begin = begin;
+        node->count = count;
+        return index;
+    }
+
+    // Splitting by the median of the centers along the longest side
+    const bool horizontal = node->bbox.w >= node->bbox.h;
+    for (size_t i = 0; i < count; ++i) {
+        const Rect r = bvh->rects[bvh->ids[begin + i]];
+        bvh->keys[i].id = bvh->ids[begin + i];
+        bvh->keys[i].key = horizontal ? r.x + r.w * 0.5f : r.y + r.h * 0.5f;
+    }
+    qsort(bvh->keys, count, sizeof(BvhKey), compare_keys);
+    for (size_t i = 0; i < count; ++i) {
+        bvh->ids[begin + i] = bvh->keys[i].id;
+    }
+
+    const size_t half = count / 2;
+    const size_t left = bvh_build(bvh, begin, half);
+    const size_t right = bvh_build(bvh, begin + half, count - half);
+
+    // bvh->nodes is allocated up front, so `node` is still valid
+    node->begin = 0;
+    node->count = 0;
+    node->left = left;
+    node->right = right;
+
+    return index;
+}
+
+Bvh *create_bvh(const Rect *rects, size_t count)
+{
+    trace_assert(rects || count == 0);
+
+    Lt *lt = create_lt();
+
+    Bvh *bvh = PUSH_LT(lt, nth_calloc(1, sizeof(Bvh)), free);
+    if (bvh == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    bvh->lt = lt;
+
+    bvh->rects = rects;
+    bvh->rects_count = count;
+
+    if (count == 0) {
+        return bvh;
+    }
+
+    bvh->ids = PUSH_LT(lt, nth_calloc(count, sizeof(size_t)), free);
+    if (bvh->ids == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        bvh->ids[i] = i;
+    }
+
+    bvh->keys = PUSH_LT(lt, nth_calloc(count, sizeof(BvhKey)), free);
+    if (bvh->keys == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    bvh->nodes = PUSH_LT(lt, nth_calloc(2 * count, sizeof(BvhNode)), free);
+    if (bvh->nodes == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    bvh_build(bvh, 0, count);
+
+    // The keys are needed only during the build
+    free(RELEASE_LT(lt, bvh->keys));
+    bvh->keys = NULL;
+
+    return bvh;
+}
+
+void destroy_bvh(Bvh *bvh)
+{
+    trace_assert(bvh);
+    RETURN_LT0(bvh->lt);
+}
+
+size_t bvh_next_overlap(const Bvh *bvh, Rect area, size_t begin)
+{
+    trace_assert(bvh);
+
+    size_t result = bvh->rects_count;
+    if (bvh->nodes_count == 0) {
+        return result;
+    }
+
+    size_t stack[BVH_STACK_SIZE];
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BvhNode *node = &bvh->nodes[stack[--stack_size]];
+
+        if (node->max_id < begin
+            || node->min_id >= result
+            || !rects_overlap(node->bbox, area)) {
+            continue;
+        }
+
+        if (node->count > 0) {
+            for (size_t i = node->begin; i < node->begin + node->count; ++i) {
+                const size_t id = bvh->ids[i];
+                if (id >= begin && id < result && rects_overlap(bvh->rects[id], area)) {
+                    result = id;
+                }
+            }
+        } else {
+            trace_assert(stack_size + 2 <= BVH_STACK_SIZE);
+
+            // The child with the smaller indices is visited first so
+            // it can prune the other one
+            const BvhNode *left = &bvh->nodes[node->left];
+            const BvhNode *right = &bvh->nodes[node->right];
+            if (left->min_id <= right->min_id) {
+                stack[stack_size++] = node->right;
+                stack[stack_size++] = node->left;
+            } else {
+                stack[stack_size++] = node->left;
+                stack[stack_size++] = node->right;
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,20 @@
+#ifndef BVH_H_
+#define BVH_H_
+
+#include "math/rect.h"
+
+typedef struct Bvh Bvh;
+
+// Static bounding volume hierarchy over `count` rects. The rects
+// themselves are not copied and must not move while the hierarchy is
+// alive.
+Bvh *create_bvh(const Rect *rects, size_t count);
+void destroy_bvh(Bvh *bvh);
+
+// Returns the smallest index that is not less than `begin` whose rect
+// overlaps `area`, or the count of the rects if there is no such
+// index. Visiting the overlapping rects in the order of their indices
+// allows to reproduce a linear scan over the rects exactly.
+size_t bvh_next_overlap(const Bvh *bvh, Rect area, size_t begin);
+
+#endif  // BVH_H_
@@ -0,0 +1,287 @@
+#include <SDL.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./bvh.h"
+#include "./tile_cache.h"
+
+// The side of a tile in the units of the world
+#define TILE_CACHE_TILE_SIZE 256.0f
+// At the default zoom the camera sees about 4x3 tiles
+#define TILE_CACHE_CAPACITY 32
+
+typedef struct {
+    // NULL if the slot is free
+    SDL_Texture *texture;
+    int x, y;
+    uint64_t last_seen;
+} Tile;
+
+struct TileCache
+{
+    Lt *lt;
+
+    const Rect *rects;
+    const Color *colors;
+    size_t count;
+    const Bvh *bvh;
+
+    // The tiles are drawn without blending, so the overlapping
+    // translucent rects can't be cached
+    bool opaque;
+    // Set when the renderer fails to render to a texture
+    bool broken;
+
+    Tile tiles[TILE_CACHE_CAPACITY];
+    // What the tiles were rendered with. The tiles are dropped when
+    // it changes.
+    Vec pixels_per_unit;
+    bool blackwhite_mode;
+    uint64_t frame;
+};
+
+TileCache *create_tile_cache(const Rect *rects,
+                             const Color *colors,
+                             size_t count,
+                             const Bvh *bvh)
+{
+    trace_assert(rects || count == 0);
+    trace_assert(colors || count == 0);
+    trace_assert(bvh);
+
+    Lt *lt = create_lt();
+
+    TileCache *tile_cache = PUSH_LT(lt, nth_calloc(1, sizeof(TileCache)), free);
+    if (tile_cache == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    tile_cache->lt = lt;
+
+    tile_cache->rects = rects;
+    tile_cache->colors = colors;
+    tile_cache->count = count;
+    tile_cache->bvh = bvh;
+
+    tile_cache->opaque = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (colors[i].a < 1.0f) {
+            tile_cache->opaque = false;
+        }
+    }
+
+    return tile_cache;
+}
+
+static void tile_cache_drop(TileCache *tile_cache)
+{
+    trace_assert(tile_cache);
+
+    for (size_t i = 0; i < TILE_CACHE_CAPACITY; ++i) {
+        if (tile_cache->tiles[i].texture != NULL) {
+            SDL_DestroyTexture(tile_cache->tiles[i].texture);
+            tile_cache->tiles[i].texture = NULL;
+        }
+    }
+}
+
+void destroy_tile_cache(TileCache *tile_cache)
+{
+    trace_assert(tile_cache);
+    tile_cache_drop(tile_cache);
+    RETURN_LT0(tile_cache->lt);
+}
+
+static void tile_cache_visible_tiles(const Camera *camera,
+                                     int *x1, int *y1,
+                                     int *x2, int *y2)
+{
+    const Rect view_port = camera_view_port(camera);
+
+    *x1 = (int) floorf(view_port.x / TILE_CACHE_TILE_SIZE);
+    *y1 = (int) floorf(view_port.y / TILE_CACHE_TILE_SIZE);
+    *x2 = (int) floorf((view_port.x + view_port.w) / TILE_CACHE_TILE_SIZE);
+    *y2 = (int) floorf((view_port.y + view_port.h) / TILE_CACHE_TILE_SIZE);
+}
+
+bool tile_cache_covers(const TileCache *tile_cache, const Camera *camera)
+{
+    trace_assert(tile_cache);
+    trace_assert(camera);
+
+    if (tile_cache->broken
+        || !tile_cache->opaque
+        || camera_is_debug_mode(camera)) {
+        return false;
+    }
+
+    int x1, y1, x2, y2;
+    tile_cache_visible_tiles(camera, &x1, &y1, &x2, &y2);
+
+    return (long) (x2 - x1 + 1) * (long) (y2 - y1 + 1) <= TILE_CACHE_CAPACITY;
+}
+
+static Rect tile_cache_area(int x, int y)
+{
+    return rect((float) x * TILE_CACHE_TILE_SIZE,
+                (float) y * TILE_CACHE_TILE_SIZE,
+                TILE_CACHE_TILE_SIZE,
+                TILE_CACHE_TILE_SIZE);
+}
+
+// The pixels of the screen the tile (x, y) covers. The edges are
+// rounded from the origin of the world rather than from the camera,
+// so the size of a tile does not change while the camera moves and
+// the neighboring tiles share their edges.
+static Rect tile_cache_screen_rect(const Camera *camera, int x, int y)
+{
+    trace_assert(camera);
+
+    const Vec origin = camera_point(camera, vec(0.0f, 0.0f));
+    const Vec pixels_per_unit = camera_pixels_per_unit(camera);
+    const float x1 = roundf((float) x * TILE_CACHE_TILE_SIZE * pixels_per_unit.x);
+    const float y1 = roundf((float) y * TILE_CACHE_TILE_SIZE * pixels_per_unit.y);
+    const float x2 = roundf((float) (x + 1) * TILE_CACHE_TILE_SIZE * pixels_per_unit.x);
+    const float y2 = roundf((float) (y + 1) * TILE_CACHE_TILE_SIZE * pixels_per_unit.y);
+
+    return rect(roundf(origin.x) + x1,
+                roundf(origin.y) + y1,
+                x2 - x1,
+                y2 - y1);
+}
+
+static int tile_cache_rasterize(TileCache *tile_cache,
+                                Camera *camera,
+                                Tile *tile)
+{
+    trace_assert(tile_cache);
+    trace_assert(camera);
+    trace_assert(tile);
+
+    const Rect area = tile_cache_area(tile->x, tile->y);
+
+    if (camera_begin_texture(camera, tile->texture, area) < 0) {
+        return -1;
+    }
+
+    // The same order as platforms_render(), so the overlapping rects
+    // look the same
+    for (size_t i = bvh_next_overlap(tile_cache->bvh, area, 0);
+         i < tile_cache->count;
+         i = bvh_next_overlap(tile_cache->bvh, area, i + 1)) {
+        if (camera_fill_rect(camera, tile_cache->rects[i], tile_cache->colors[i]) < 0) {
+            camera_end_texture(camera);
+            return -1;
+        }
+    }
+
+    return camera_end_texture(camera);
+}
+
+static Tile *tile_cache_tile(TileCache *tile_cache,
+                             Camera *camera,
+                             int x, int y)
+{
+    trace_assert(tile_cache);
+    trace_assert(camera);
+
+    Tile *lru = &tile_cache->tiles[0];
+    for (size_t i = 0; i < TILE_CACHE_CAPACITY; ++i) {
+        Tile *tile = &tile_cache->tiles[i];
+
+        if (tile->texture != NULL && tile->x == x && tile->y == y) {
+            tile->last_seen = tile_cache->frame;
+            return tile;
+        }
+
+        if (lru->texture != NULL
+            && (tile->texture == NULL || tile->last_seen < lru->last_seen)) {
+            lru = tile;
+        }
+    }
+
+    if (lru->texture != NULL) {
+        SDL_DestroyTexture(lru->texture);
+        lru->texture = NULL;
+    }
+
+    // Exactly as big as the tile is drawn, so it's not stretched
+    const Rect screen_rect = tile_cache_screen_rect(camera, x, y);
+    lru->texture = SDL_CreateTexture(
+        camera_renderer(camera),
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_TARGET,
+        (int) screen_rect.w,
+        (int) screen_rect.h);
+    if (lru->texture == NULL) {
+        log_warn("Could not create a tile of the platforms: %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    if (SDL_SetTextureBlendMode(lru->texture, SDL_BLENDMODE_BLEND) < 0) {
+        log_warn("SDL_SetTextureBlendMode: %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    lru->x = x;
+    lru->y = y;
+    lru->last_seen = tile_cache->frame;
+
+    if (tile_cache_rasterize(tile_cache, camera, lru) < 0) {
+        return NULL;
+    }
+
+    return lru;
+}
+
+int tile_cache_render(TileCache *tile_cache, Camera *camera)
+{
+    trace_assert(tile_cache);
+    trace_assert(camera);
+    trace_assert(tile_cache_covers(tile_cache, camera));
+
+    const Vec pixels_per_unit = camera_pixels_per_unit(camera);
+    const bool blackwhite_mode = camera_is_blackwhite_mode(camera);
+    if (pixels_per_unit.x != tile_cache->pixels_per_unit.x
+        || pixels_per_unit.y != tile_cache->pixels_per_unit.y
+        || blackwhite_mode != tile_cache->blackwhite_mode) {
+        tile_cache_drop(tile_cache);
+        tile_cache->pixels_per_unit = pixels_per_unit;
+        tile_cache->blackwhite_mode = blackwhite_mode;
+    }
+
+    tile_cache->frame++;
+
+    int x1, y1, x2, y2;
+    tile_cache_visible_tiles(camera, &x1, &y1, &x2, &y2);
+
+    for (int y = y1; y <= y2; ++y) {
+        for (int x = x1; x <= x2; ++x) {
+            const Rect area = tile_cache_area(x, y);
+
+            // Most of the world is empty
+            if (bvh_next_overlap(tile_cache->bvh, area, 0) >= tile_cache->count) {
+                continue;
+            }
+
+            Tile *tile = tile_cache_tile(tile_cache, camera, x, y);
+            if (tile == NULL
+                || camera_render_texture_screen(
+                    camera,
+                    tile->texture,
+                    tile_cache_screen_rect(camera, x, y)) < 0) {
+                // Whatever went wrong will most likely go wrong again
+                tile_cache->broken = true;
+                tile_cache_drop(tile_cache);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
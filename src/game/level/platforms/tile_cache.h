@@ -0,0 +1,31 @@
+#ifndef TILE_CACHE_H_
+#define TILE_CACHE_H_
+
+#include <stdbool.h>
+
+#include "color.h"
+#include "game/camera.h"
+#include "math/rect.h"
+
+typedef struct TileCache TileCache;
+typedef struct Bvh Bvh;
+
+// Keeps the rects that never move rasterized into square tiles of the
+// world. The tiles are rendered when they are seen for the first time
+// and the least recently seen ones are dropped when there are too
+// many of them. The rects, the colors and the hierarchy over the
+// rects are not copied and must outlive the cache.
+TileCache *create_tile_cache(const Rect *rects,
+                             const Color *colors,
+                             size_t count,
+                             const Bvh *bvh);
+void destroy_tile_cache(TileCache *tile_cache);
+
+// Whether tile_cache_render() can draw what the camera currently
+// sees. It can't if the rects are not opaque, in debug mode, if the
+// camera sees too many tiles at once or if the renderer can't render
+// to textures.
+bool tile_cache_covers(const TileCache *tile_cache, const Camera *camera);
+int tile_cache_render(TileCache *tile_cache, Camera *camera);
+
+#endif  // TILE_CACHE_H_
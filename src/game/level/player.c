@@ -71,6 +71,9 @@ Player *create_player_from_player_layer(const PlayerLayer *player_layer,
             player_layer->position.y,
             PLAYER_WIDTH,
             PLAYER_HEIGHT));
+    if (player->alive_body_id == RIGID_BODIES_NO_ID) {
+        RETURN_LT(lt, NULL);
+    }
 
     player->dying_body = PUSH_LT(
         lt,
@@ -108,7 +111,7 @@ int player_render(const Player * player,
     switch (player->state) {
     case PLAYER_STATE_ALIVE: {
         snprintf(debug_text, 256, "Jump: %d", player->jump_threshold);
-        Rect hitbox = rigid_bodies_hitbox(player->rigid_bodies, player->alive_body_id);
+        Rect hitbox = rigid_bodies_interpolated_hitbox(player->rigid_bodies, player->alive_body_id);
 
         if (camera_render_debug_text(camera, debug_text, vec(hitbox.x, hitbox.y - 20.0f)) < 0) {
             return -1;
@@ -137,8 +140,7 @@ void player_update(Player *player,
 
     switch (player->state) {
     case PLAYER_STATE_ALIVE: {
-        rigid_bodies_update(player->rigid_bodies, player->alive_body_id, delta_time);
-
+        // The body itself is integrated by rigid_bodies_integrate_all()
         const Rect hitbox = rigid_bodies_hitbox(player->rigid_bodies, player->alive_body_id);
 
 
@@ -242,7 +244,7 @@ void player_focus_camera(Player *player,
     trace_assert(player);
     trace_assert(camera);
 
-    const Rect player_hitbox = rigid_bodies_hitbox(
+    const Rect player_hitbox = rigid_bodies_interpolated_hitbox(
         player->rigid_bodies,
         player->alive_body_id);
 
@@ -1,5 +1,11 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RIGID_BODIES_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "game/camera.h"
 #include "game/level/platforms.h"
@@ -9,10 +15,70 @@
 #include "system/line_stream.h"
 #include "system/str.h"
 #include "system/log.h"
-#include "hashset.h"
+#include "dynarray.h"
+#include "game/level/rigid_bodies/uniform_grid.h"
+#include "game/level/rigid_bodies/sweep_and_prune.h"
+#include "game/level/rigid_bodies/pair_table.h"
+#include "game/level/rigid_bodies/islands.h"
+#include "game/level/rigid_bodies/thread_pool.h"
 
 #include "./rigid_bodies.h"
 
+#define RIGID_BODIES_GRID_CELL_SIZE 128.0f
+// The collided pairs are packed by PairTable
+#define RIGID_BODIES_MAX_CAPACITY (PAIR_TABLE_MAX_ID + 1)
+// The bodies closer than that are considered to be in contact
+#define RIGID_BODIES_CONTACT_MARGIN 1.0f
+#define RIGID_BODIES_SLEEP_VELOCITY 2.0f
+#define RIGID_BODIES_SLEEP_FORCE 100.0f
+#define RIGID_BODIES_SLEEP_TICKS 30
+#define RIGID_BODIES_SLEEP_PENETRATION 0.5f
+// How many times the overlapping bodies are pushed apart per collision
+#define RIGID_BODIES_MAX_PASSES 1000
+// How many bodies a single job snaps to the platforms
+#define RIGID_BODIES_PLATFORMS_JOB_SIZE 64
+// The bodies that were already pushed apart and still overlap less
+// than that keep their previous contact instead of being pushed again
+#define RIGID_BODIES_CONTACT_SLOP 0.05f
+
+// RigidBodyId is a handle. Its lower bits select an entry of the
+// handle table and the rest is the generation of that entry. The
+// generation is bumped every time the body is removed, so the stale ids
+// are not mistaken for the bodies that reuse the entry later.
+#define RIGID_BODIES_ID_INDEX_BITS 16
+#define RIGID_BODIES_ID_INDEX_MASK (((RigidBodyId) 1 << RIGID_BODIES_ID_INDEX_BITS) - 1)
+#define RIGID_BODIES_ID_GENERATION_MASK (SIZE_MAX >> RIGID_BODIES_ID_INDEX_BITS)
+
+// How the collision of two bodies was resolved
+typedef struct {
+    // As returned by rect_impulse()
+    Vec orient;
+    // Whether the first or the second body of the pair stands on the
+    // other one
+    bool grounded1;
+    bool grounded2;
+} Contact;
+
+typedef enum {
+    CONTACT_NONE = 0,
+    // The bodies were pushed apart
+    CONTACT_NEW,
+    // The bodies were pushed apart before and the contact was reused
+    CONTACT_CACHED
+} ContactKind;
+
+typedef struct {
+    // The collided pairs of the island are
+    // island_collided[begin..begin + collided_count), where `begin` is
+    // the beginning of the island in islands_pairs(). Their contacts
+    // are in island_contacts at the same indices.
+    size_t collided_count;
+    // Whether any of the pairs had to be pushed apart
+    bool pushed;
+} IslandResult;
+
+// The arrays indexed by slots are kept dense: the first `count` slots
+// hold the live bodies. A removed body is replaced by the last one.
 struct RigidBodies
 {
     Lt *lt;
@@ -24,13 +90,73 @@ struct RigidBodies
     Vec *movements;
     bool *grounded;
     Vec *forces;
-    bool *deleted;
-    HashSet *collided;
+    PairTable *collided;
+    // The contacts of the collided pairs indexed like `collided`
+    Contact *contacts;
+    size_t contacts_capacity;
+    // The collided pairs and the contacts of the previous collision.
+    // The contacts are reused while the bodies stay in contact, see
+    // rigid_bodies_collide_pair().
+    PairTable *prev_collided;
+    Contact *prev_contacts;
+    size_t prev_contacts_capacity;
     bool *disabled;
+    // The bodies that were moved since the previous collision
+    bool *dirty;
+    bool *asleep;
+    // For how many collisions in a row the body has been at rest
+    size_t *still_ticks;
+    // All bits are set for the bodies that are integrated by
+    // rigid_bodies_integrate_all(). Refreshed on each call.
+    uint32_t *live_mask;
+    // Positions at the beginning of the last physics step. The bodies
+    // are rendered in between them and the current ones.
+    Vec *prev_positions;
+    float alpha;
+
+    // Broadphase
+    BroadphaseType broadphase;
+    UniformGrid *grid;
+    SweepAndPrune *sap;
+    Dynarray *candidates;
+
+    // Island solver. The bodies are split into groups that can't touch
+    // each other and the groups are solved on the thread pool. Without
+    // the pool the pairs are solved one by one instead.
+    ThreadPool *thread_pool;
+    Islands *islands;
+    // The candidates with at least one dirty body
+    Dynarray *active_pairs;
+    IslandResult *island_results;
+    size_t island_results_capacity;
+    // Indexed like islands_pairs()
+    size_t *island_collided;
+    Contact *island_contacts;
+    size_t island_pairs_capacity;
+
+    // Handle table: maps RigidBodyId to the slot of the body
+    size_t *handle_slots;
+    size_t *handle_generations;
+    size_t handles_count;
+    // The handle of the body in each slot
+    size_t *slot_handles;
+    // The handles of the removed bodies that can be given away again
+    Dynarray *free_handles;
+
+    // Debug stats of the last collision
+    size_t dirty_count;
+    size_t asleep_count;
+    size_t candidates_count;
+    size_t overlaps_count;
+    size_t swept_count;
 };
 
-RigidBodies *create_rigid_bodies(size_t capacity)
+RigidBodies *create_rigid_bodies(size_t capacity,
+                                 BroadphaseType broadphase)
 {
+    trace_assert(capacity > 0);
+    trace_assert(capacity <= RIGID_BODIES_MAX_CAPACITY);
+
     Lt *lt = create_lt();
 
     RigidBodies *rigid_bodies = PUSH_LT(lt, nth_calloc(1, sizeof(RigidBodies)), free);
@@ -67,16 +193,19 @@ RigidBodies *create_rigid_bodies(size_t capacity)
         RETURN_LT(lt, NULL);
     }
 
-    rigid_bodies->deleted = PUSH_LT(lt, nth_calloc(capacity, sizeof(bool)), free);
-    if (rigid_bodies->deleted == NULL) {
+    rigid_bodies->collided = PUSH_LT(
+        lt,
+        create_pair_table(capacity * 2),
+        destroy_pair_table);
+    if (rigid_bodies->collided == NULL) {
         RETURN_LT(lt, NULL);
     }
 
-    rigid_bodies->collided = PUSH_LT(
+    rigid_bodies->prev_collided = PUSH_LT(
         lt,
-        create_hashset(sizeof(size_t) * 2, capacity * 2),
-        destroy_hashset);
-    if (rigid_bodies->collided == NULL) {
+        create_pair_table(capacity * 2),
+        destroy_pair_table);
+    if (rigid_bodies->prev_collided == NULL) {
         RETURN_LT(lt, NULL);
     }
 
@@ -88,6 +217,105 @@ RigidBodies *create_rigid_bodies(size_t capacity)
         RETURN_LT(lt, NULL);
     }
 
+    rigid_bodies->dirty = PUSH_LT(lt, nth_calloc(capacity, sizeof(bool)), free);
+    if (rigid_bodies->dirty == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->live_mask = PUSH_LT(lt, nth_calloc(capacity, sizeof(uint32_t)), free);
+    if (rigid_bodies->live_mask == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->prev_positions = PUSH_LT(lt, nth_calloc(capacity, sizeof(Vec)), free);
+    if (rigid_bodies->prev_positions == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    rigid_bodies->alpha = 1.0f;
+
+    rigid_bodies->asleep = PUSH_LT(lt, nth_calloc(capacity, sizeof(bool)), free);
+    if (rigid_bodies->asleep == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->still_ticks = PUSH_LT(lt, nth_calloc(capacity, sizeof(size_t)), free);
+    if (rigid_bodies->still_ticks == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->broadphase = broadphase;
+
+    switch (broadphase) {
+    case BROADPHASE_ALL_PAIRS:
+        break;
+
+    case BROADPHASE_UNIFORM_GRID: {
+        rigid_bodies->grid = PUSH_LT(
+            lt,
+            create_uniform_grid(
+                RIGID_BODIES_GRID_CELL_SIZE,
+                RIGID_BODIES_CONTACT_MARGIN),
+            destroy_uniform_grid);
+        if (rigid_bodies->grid == NULL) {
+            RETURN_LT(lt, NULL);
+        }
+    } break;
+
+    case BROADPHASE_SWEEP_AND_PRUNE: {
+        rigid_bodies->sap = PUSH_LT(
+            lt,
+            create_sweep_and_prune(RIGID_BODIES_CONTACT_MARGIN),
+            destroy_sweep_and_prune);
+        if (rigid_bodies->sap == NULL) {
+            RETURN_LT(lt, NULL);
+        }
+    } break;
+    }
+
+    rigid_bodies->candidates = PUSH_LT(
+        lt,
+        create_dynarray(sizeof(size_t) * 2),
+        destroy_dynarray);
+    if (rigid_bodies->candidates == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->islands = PUSH_LT(lt, create_islands(), destroy_islands);
+    if (rigid_bodies->islands == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->active_pairs = PUSH_LT(
+        lt,
+        create_dynarray(sizeof(size_t) * 2),
+        destroy_dynarray);
+    if (rigid_bodies->active_pairs == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->handle_slots = PUSH_LT(lt, nth_calloc(capacity, sizeof(size_t)), free);
+    if (rigid_bodies->handle_slots == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->handle_generations = PUSH_LT(lt, nth_calloc(capacity, sizeof(size_t)), free);
+    if (rigid_bodies->handle_generations == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->slot_handles = PUSH_LT(lt, nth_calloc(capacity, sizeof(size_t)), free);
+    if (rigid_bodies->slot_handles == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    rigid_bodies->free_handles = PUSH_LT(
+        lt,
+        create_dynarray(sizeof(size_t)),
+        destroy_dynarray);
+    if (rigid_bodies->free_handles == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
     return rigid_bodies;
 }
 
@@ -97,75 +325,671 @@ void destroy_rigid_bodies(RigidBodies *rigid_bodies)
     RETURN_LT0(rigid_bodies->lt);
 }
 
-static int rigid_bodies_collide_with_itself(RigidBodies *rigid_bodies)
+int rigid_bodies_set_island_threads(RigidBodies *rigid_bodies,
+                                    size_t threads_count)
 {
     trace_assert(rigid_bodies);
 
-    if (rigid_bodies->count == 0) {
+    if (threads_count == 0) {
+        if (rigid_bodies->thread_pool != NULL) {
+            destroy_thread_pool(RELEASE_LT(rigid_bodies->lt, rigid_bodies->thread_pool));
+            rigid_bodies->thread_pool = NULL;
+        }
         return 0;
     }
 
-    size_t pair[2];
-    hashset_clear(rigid_bodies->collided);
+    if (rigid_bodies->thread_pool != NULL
+        && thread_pool_threads_count(rigid_bodies->thread_pool) == threads_count) {
+        return 0;
+    }
+
+    ThreadPool *thread_pool = create_thread_pool(threads_count);
+    if (thread_pool == NULL) {
+        return -1;
+    }
+
+    if (rigid_bodies->thread_pool == NULL) {
+        rigid_bodies->thread_pool = PUSH_LT(rigid_bodies->lt, thread_pool, destroy_thread_pool);
+    } else {
+        rigid_bodies->thread_pool = RESET_LT(rigid_bodies->lt, rigid_bodies->thread_pool, thread_pool);
+    }
+
+    return 0;
+}
+
+// Finds the slot of the body `id`. Returns false if the body was
+// removed.
+static bool rigid_bodies_slot(const RigidBodies *rigid_bodies,
+                              RigidBodyId id,
+                              size_t *slot)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(slot);
+
+    const size_t handle = id & RIGID_BODIES_ID_INDEX_MASK;
+    const size_t generation = id >> RIGID_BODIES_ID_INDEX_BITS;
+
+    if (handle >= rigid_bodies->handles_count
+        || rigid_bodies->handle_generations[handle] != generation) {
+        return false;
+    }
+
+    *slot = rigid_bodies->handle_slots[handle];
+    return true;
+}
+
+bool rigid_bodies_exists(const RigidBodies *rigid_bodies,
+                         RigidBodyId id)
+{
+    size_t slot;
+    return rigid_bodies_slot(rigid_bodies, id, &slot);
+}
+
+static void rigid_bodies_wake(RigidBodies *rigid_bodies, size_t id)
+{
+    trace_assert(rigid_bodies);
+
+    rigid_bodies->asleep[id] = false;
+    rigid_bodies->still_ticks[id] = 0;
+}
+
+static bool rigid_bodies_in_contact(const RigidBodies *rigid_bodies,
+                                    size_t i1, size_t i2)
+{
+    trace_assert(rigid_bodies);
+
+    return rects_overlap(
+        rect_scale(rigid_bodies->bodies[i1], RIGID_BODIES_CONTACT_MARGIN),
+        rect_scale(rigid_bodies->bodies[i2], RIGID_BODIES_CONTACT_MARGIN));
+}
+
+// Wakes up the sleeping bodies that were resting on (or were rested on
+// by) the body `id` before it moved or disappeared
+static void rigid_bodies_wake_neighbours(RigidBodies *rigid_bodies, size_t id)
+{
+    trace_assert(rigid_bodies);
+
+    for (size_t i = 0; i < rigid_bodies->count; ++i) {
+        if (i != id
+            && rigid_bodies->asleep[i]
+            && !rigid_bodies->disabled[i]
+            && rigid_bodies_in_contact(rigid_bodies, i, id)) {
+            rigid_bodies_wake(rigid_bodies, i);
+        }
+    }
+}
+
+static void rigid_bodies_apply_force_at(RigidBodies *rigid_bodies,
+                                        size_t slot,
+                                        Vec force)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(slot < rigid_bodies->count);
+
+    if (rigid_bodies->disabled[slot]) {
+        return;
+    }
+
+    if (force.x != 0.0f || force.y != 0.0f) {
+        rigid_bodies->forces[slot] = vec_sum(rigid_bodies->forces[slot], force);
+
+        if (rigid_bodies->asleep[slot]) {
+            rigid_bodies_wake(rigid_bodies, slot);
+        }
+    }
+}
+
+static void rigid_bodies_damper_at(RigidBodies *rigid_bodies,
+                                   size_t slot,
+                                   Vec v)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(slot < rigid_bodies->count);
+
+    rigid_bodies_apply_force_at(
+        rigid_bodies, slot,
+        vec(
+            rigid_bodies->velocities[slot].x * v.x,
+            rigid_bodies->velocities[slot].y * v.y));
+}
+
+// Fills up rigid_bodies->candidates with the pairs of bodies that may
+// overlap according to the broadphase
+static int rigid_bodies_find_candidates(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    dynarray_clear(rigid_bodies->candidates);
+
+    switch (rigid_bodies->broadphase) {
+    case BROADPHASE_ALL_PAIRS:
+        // All of the pairs are iterated directly by
+        // rigid_bodies_find_active_pairs()
+        break;
+
+    case BROADPHASE_UNIFORM_GRID: {
+        uniform_grid_clear(rigid_bodies->grid);
+
+        for (size_t i = 0; i < rigid_bodies->count; ++i) {
+            if (rigid_bodies->disabled[i]) {
+                continue;
+            }
+
+            if (uniform_grid_insert(rigid_bodies->grid, i, rigid_bodies->bodies[i]) < 0) {
+                return -1;
+            }
+        }
+
+        if (uniform_grid_pairs(
+                rigid_bodies->grid,
+                rigid_bodies->bodies,
+                rigid_bodies->candidates) < 0) {
+            return -1;
+        }
+    } break;
+
+    case BROADPHASE_SWEEP_AND_PRUNE: {
+        if (sweep_and_prune_pairs(
+                rigid_bodies->sap,
+                rigid_bodies->bodies,
+                rigid_bodies->candidates) < 0) {
+            return -1;
+        }
+    } break;
+    }
+
+    return 0;
+}
+
+// Looks up the contact of the pair made earlier during this collision
+// or during the previous one
+static bool rigid_bodies_find_contact(const RigidBodies *rigid_bodies,
+                                      size_t i1, size_t i2,
+                                      Contact *contact)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(contact);
+
+    size_t index = 0;
+    if (pair_table_find(rigid_bodies->collided, i1, i2, &index)) {
+        *contact = rigid_bodies->contacts[index];
+        return true;
+    }
+
+    if (pair_table_find(rigid_bodies->prev_collided, i1, i2, &index)) {
+        *contact = rigid_bodies->prev_contacts[index];
+        return true;
+    }
+
+    return false;
+}
+
+static void rigid_bodies_apply_contact(RigidBodies *rigid_bodies,
+                                       size_t i1, size_t i2,
+                                       Contact contact)
+{
+    trace_assert(rigid_bodies);
+
+    if (contact.grounded1) {
+        rigid_bodies->grounded[i1] = true;
+    }
+    if (contact.grounded2) {
+        rigid_bodies->grounded[i2] = true;
+    }
+
+    rigid_bodies->velocities[i1] = vec_entry_mult(rigid_bodies->velocities[i1], contact.orient);
+    rigid_bodies->velocities[i2] = vec_entry_mult(rigid_bodies->velocities[i2], contact.orient);
+    rigid_bodies->movements[i1] = vec_entry_mult(rigid_bodies->movements[i1], contact.orient);
+    rigid_bodies->movements[i2] = vec_entry_mult(rigid_bodies->movements[i2], contact.orient);
+}
+
+// Pushes the bodies i1 and i2 out of each other if they overlap and
+// sets `*contact` to how they were pushed. The pairs that were already
+// pushed apart and overlap only by a rounding error are not pushed
+// again: their last contact is reused. Otherwise the passes would go
+// on until RIGID_BODIES_MAX_PASSES chasing the rounding errors of the
+// stacked bodies. The pairs of bodies that did not move since the
+// previous collision are skipped. Touches only the bodies i1 and i2,
+// so the islands can be solved concurrently.
+static ContactKind rigid_bodies_collide_pair(RigidBodies *rigid_bodies,
+                                             size_t i1, size_t i2,
+                                             Contact *contact)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(contact);
+
+    if (!rigid_bodies->dirty[i1] && !rigid_bodies->dirty[i2]) {
+        return CONTACT_NONE;
+    }
+
+    if (!rects_overlap(rigid_bodies->bodies[i1], rigid_bodies->bodies[i2])) {
+        // A body that started moving on its own (it was not at rest on
+        // the previous collision) wakes up the sleeping bodies it
+        // touches. Otherwise a stack would hang in the air after its
+        // support is pushed away.
+        if (rigid_bodies->asleep[i1] != rigid_bodies->asleep[i2]) {
+            const size_t awake = rigid_bodies->asleep[i1] ? i2 : i1;
+            const size_t sleeping = rigid_bodies->asleep[i1] ? i1 : i2;
+
+            if (rigid_bodies->dirty[awake]
+                && rigid_bodies->still_ticks[awake] == 0
+                && rigid_bodies_in_contact(rigid_bodies, awake, sleeping)) {
+                rigid_bodies_wake(rigid_bodies, sleeping);
+                rigid_bodies->dirty[sleeping] = true;
+            }
+        }
+
+        return CONTACT_NONE;
+    }
+
+    rigid_bodies->dirty[i1] = true;
+    rigid_bodies->dirty[i2] = true;
+
+    // Resting bodies keep overlapping by a rounding error that
+    // rect_impulse() can never quite resolve. Such overlaps should
+    // not prevent them from falling asleep.
+    const Rect area = rects_overlap_area(rigid_bodies->bodies[i1], rigid_bodies->bodies[i2]);
+    if (fminf(area.w, area.h) > RIGID_BODIES_SLEEP_PENETRATION) {
+        rigid_bodies_wake(rigid_bodies, i1);
+        rigid_bodies_wake(rigid_bodies, i2);
+    }
+
+    if (fminf(area.w, area.h) <= RIGID_BODIES_CONTACT_SLOP
+        && rigid_bodies_find_contact(rigid_bodies, i1, i2, contact)) {
+        rigid_bodies_apply_contact(rigid_bodies, i1, i2, *contact);
+        return CONTACT_CACHED;
+    }
+
+    contact->orient = rect_impulse(&rigid_bodies->bodies[i1], &rigid_bodies->bodies[i2]);
+    contact->grounded1 = false;
+    contact->grounded2 = false;
 
-    bool the_variable_that_gets_set_when_a_collision_happens_xd = true;
+    if (contact->orient.x > contact->orient.y) {
+        if (rigid_bodies->bodies[i1].y < rigid_bodies->bodies[i2].y) {
+            contact->grounded1 = true;
+        } else {
+            contact->grounded2 = true;
+        }
+    }
+
+    rigid_bodies_apply_contact(rigid_bodies, i1, i2, *contact);
+
+    return CONTACT_NEW;
+}
+
+// Reallocates the scratch `array` of the collision that may not be
+// allocated yet. Returns NULL on failure leaving `array` untouched.
+static void *rigid_bodies_realloc_scratch(RigidBodies *rigid_bodies,
+                                          void *array,
+                                          size_t size)
+{
+    trace_assert(rigid_bodies);
 
-    for (size_t i = 0; i < 1000 && the_variable_that_gets_set_when_a_collision_happens_xd; ++i) {
-        the_variable_that_gets_set_when_a_collision_happens_xd = false;
-        for (size_t i1 = 0; i1 < rigid_bodies->count - 1; ++i1) {
-            if (rigid_bodies->deleted[i1] || rigid_bodies->disabled[i1]) {
+    void *new_array = nth_realloc(array, size);
+    if (new_array == NULL) {
+        return NULL;
+    }
+
+    if (array == NULL) {
+        return PUSH_LT(rigid_bodies->lt, new_array, free);
+    }
+
+    return REPLACE_LT(rigid_bodies->lt, array, new_array);
+}
+
+static void rigid_bodies_remember_collision(RigidBodies *rigid_bodies,
+                                            size_t i1, size_t i2,
+                                            Contact contact)
+{
+    trace_assert(rigid_bodies);
+
+    size_t index = 0;
+    if (pair_table_insert(rigid_bodies->collided, i1, i2, &index) < 0) {
+        log_fail("Could not remember the collision of bodies %zu and %zu\n", i1, i2);
+        return;
+    }
+
+    if (index >= rigid_bodies->contacts_capacity) {
+        const size_t new_capacity = rigid_bodies->contacts_capacity > 0
+            ? rigid_bodies->contacts_capacity * 2
+            : rigid_bodies->capacity;
+        Contact *new_contacts = rigid_bodies_realloc_scratch(
+            rigid_bodies,
+            rigid_bodies->contacts,
+            new_capacity * sizeof(Contact));
+        if (new_contacts == NULL) {
+            log_fail("Could not remember the contact of bodies %zu and %zu\n", i1, i2);
+            return;
+        }
+        rigid_bodies->contacts = new_contacts;
+        rigid_bodies->contacts_capacity = new_capacity;
+    }
+
+    rigid_bodies->contacts[index] = contact;
+}
+
+// Fills up rigid_bodies->active_pairs with the candidates that have at
+// least one dirty body. The rest of the pairs are skipped by
+// rigid_bodies_collide_pair() anyway.
+static int rigid_bodies_find_active_pairs(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    dynarray_clear(rigid_bodies->active_pairs);
+
+    size_t pair[2];
+
+    if (rigid_bodies->broadphase == BROADPHASE_ALL_PAIRS) {
+        for (pair[0] = 0; pair[0] + 1 < rigid_bodies->count; ++pair[0]) {
+            if (rigid_bodies->disabled[pair[0]]) {
                 continue;
             }
 
-            for (size_t i2 = i1 + 1; i2 < rigid_bodies->count; ++i2) {
-                if (rigid_bodies->deleted[i2] || rigid_bodies->disabled[i1]) {
+            for (pair[1] = pair[0] + 1; pair[1] < rigid_bodies->count; ++pair[1]) {
+                if (rigid_bodies->disabled[pair[1]]) {
                     continue;
                 }
 
-                if (!rects_overlap(rigid_bodies->bodies[i1], rigid_bodies->bodies[i2])) {
-                    continue;
+                rigid_bodies->candidates_count++;
+                if ((rigid_bodies->dirty[pair[0]] || rigid_bodies->dirty[pair[1]])
+                    && dynarray_push(rigid_bodies->active_pairs, pair) < 0) {
+                    return -1;
                 }
+            }
+        }
 
-                the_variable_that_gets_set_when_a_collision_happens_xd = true;
+        return 0;
+    }
 
-                pair[0] = i1;
-                pair[1] = i2;
-                hashset_insert(rigid_bodies->collided, pair);
+    if (rigid_bodies_find_candidates(rigid_bodies) < 0) {
+        return -1;
+    }
 
-                Vec orient = rect_impulse(&rigid_bodies->bodies[i1], &rigid_bodies->bodies[i2]);
+    const size_t n = dynarray_count(rigid_bodies->candidates);
+    const size_t *candidates = dynarray_data(rigid_bodies->candidates);
+    rigid_bodies->candidates_count += n;
 
-                if (orient.x > orient.y) {
-                    if (rigid_bodies->bodies[i1].y < rigid_bodies->bodies[i2].y) {
-                        rigid_bodies->grounded[i1] = true;
-                    } else {
-                        rigid_bodies->grounded[i2] = true;
-                    }
-                }
+    for (size_t j = 0; j < n; ++j) {
+        pair[0] = candidates[j * 2];
+        pair[1] = candidates[j * 2 + 1];
 
-                rigid_bodies->velocities[i1] = vec(rigid_bodies->velocities[i1].x * orient.x, rigid_bodies->velocities[i1].y * orient.y);
-                rigid_bodies->velocities[i2] = vec(rigid_bodies->velocities[i2].x * orient.x, rigid_bodies->velocities[i2].y * orient.y);
-                rigid_bodies->movements[i1] = vec(rigid_bodies->movements[i1].x * orient.x, rigid_bodies->movements[i1].y * orient.y);
-                rigid_bodies->movements[i2] = vec(rigid_bodies->movements[i2].x * orient.x, rigid_bodies->movements[i2].y * orient.y);
+        if ((rigid_bodies->dirty[pair[0]] || rigid_bodies->dirty[pair[1]])
+            && dynarray_push(rigid_bodies->active_pairs, pair) < 0) {
+            return -1;
+        }
+    }
 
-            }
+    return 0;
+}
+
+static int rigid_bodies_reserve_islands(RigidBodies *rigid_bodies,
+                                        size_t islands_count,
+                                        size_t pairs_count)
+{
+    trace_assert(rigid_bodies);
+
+    if (islands_count > rigid_bodies->island_results_capacity) {
+        IslandResult *new_results = rigid_bodies_realloc_scratch(
+            rigid_bodies,
+            rigid_bodies->island_results,
+            islands_count * sizeof(IslandResult));
+        if (new_results == NULL) {
+            return -1;
+        }
+        rigid_bodies->island_results = new_results;
+        rigid_bodies->island_results_capacity = islands_count;
+    }
+
+    if (pairs_count > rigid_bodies->island_pairs_capacity) {
+        size_t *new_island_collided = rigid_bodies_realloc_scratch(
+            rigid_bodies,
+            rigid_bodies->island_collided,
+            pairs_count * sizeof(size_t));
+        if (new_island_collided == NULL) {
+            return -1;
+        }
+        rigid_bodies->island_collided = new_island_collided;
+
+        Contact *new_island_contacts = rigid_bodies_realloc_scratch(
+            rigid_bodies,
+            rigid_bodies->island_contacts,
+            pairs_count * sizeof(Contact));
+        if (new_island_contacts == NULL) {
+            return -1;
+        }
+        rigid_bodies->island_contacts = new_island_contacts;
+
+        rigid_bodies->island_pairs_capacity = pairs_count;
+    }
+
+    return 0;
+}
+
+// ThreadPoolJob. Pushes apart the overlapping bodies of the island
+// `index` once.
+static void rigid_bodies_solve_island(void *context, size_t index)
+{
+    RigidBodies *rigid_bodies = context;
+    trace_assert(rigid_bodies);
+
+    size_t begin, end;
+    islands_range(rigid_bodies->islands, index, &begin, &end);
+
+    const size_t *island_pairs = islands_pairs(rigid_bodies->islands);
+    const size_t *pairs = dynarray_data(rigid_bodies->active_pairs);
+    IslandResult *result = &rigid_bodies->island_results[index];
+
+    result->collided_count = 0;
+    result->pushed = false;
+
+    for (size_t k = begin; k < end; ++k) {
+        const size_t j = island_pairs[k];
+
+        Contact contact;
+        const ContactKind kind = rigid_bodies_collide_pair(
+            rigid_bodies, pairs[j * 2], pairs[j * 2 + 1], &contact);
+        if (kind != CONTACT_NONE) {
+            rigid_bodies->island_collided[begin + result->collided_count] = j;
+            rigid_bodies->island_contacts[begin + result->collided_count] = contact;
+            result->collided_count++;
+            result->pushed = result->pushed || kind == CONTACT_NEW;
+        }
+    }
+}
+
+// Solves the active pairs of a pass one by one on the calling thread.
+// Sets `*collision` when any of the pairs had to be pushed apart.
+static void rigid_bodies_solve_pairs(RigidBodies *rigid_bodies, bool *collision)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(collision);
+
+    const size_t pairs_count = dynarray_count(rigid_bodies->active_pairs);
+    const size_t *pairs = dynarray_data(rigid_bodies->active_pairs);
+
+    for (size_t j = 0; j < pairs_count; ++j) {
+        Contact contact;
+        const ContactKind kind = rigid_bodies_collide_pair(
+            rigid_bodies, pairs[j * 2], pairs[j * 2 + 1], &contact);
+        if (kind != CONTACT_NONE) {
+            rigid_bodies->overlaps_count++;
+            rigid_bodies_remember_collision(
+                rigid_bodies, pairs[j * 2], pairs[j * 2 + 1], contact);
+            *collision = *collision || kind == CONTACT_NEW;
+        }
+    }
+}
+
+// Solves the active pairs of a pass island by island on the thread
+// pool. Sets `*collision` when any of the pairs had to be pushed apart.
+static int rigid_bodies_solve_islands(RigidBodies *rigid_bodies, bool *collision)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(collision);
+
+    const size_t pairs_count = dynarray_count(rigid_bodies->active_pairs);
+    const size_t *pairs = dynarray_data(rigid_bodies->active_pairs);
+
+    if (islands_build(rigid_bodies->islands, pairs, pairs_count, rigid_bodies->count) < 0) {
+        return -1;
+    }
+
+    const size_t count = islands_count(rigid_bodies->islands);
+    if (rigid_bodies_reserve_islands(rigid_bodies, count, pairs_count) < 0) {
+        return -1;
+    }
+
+    thread_pool_run(
+        rigid_bodies->thread_pool,
+        rigid_bodies_solve_island,
+        rigid_bodies,
+        count);
+
+    // Merging the results in the order of the islands keeps them
+    // independent from the number of threads
+    for (size_t i = 0; i < count; ++i) {
+        const IslandResult *result = &rigid_bodies->island_results[i];
+
+        size_t begin, end;
+        islands_range(rigid_bodies->islands, i, &begin, &end);
+
+        for (size_t k = begin; k < begin + result->collided_count; ++k) {
+            const size_t j = rigid_bodies->island_collided[k];
+            rigid_bodies_remember_collision(
+                rigid_bodies, pairs[j * 2], pairs[j * 2 + 1],
+                rigid_bodies->island_contacts[k]);
+        }
+
+        rigid_bodies->overlaps_count += result->collided_count;
+        *collision = *collision || result->pushed;
+    }
+
+    return 0;
+}
+
+// Pushes apart the overlapping bodies pass by pass until none of them
+// has to be pushed. The pairs of each pass are taken from the dirty
+// bodies at the beginning of the pass. Without a thread pool they are
+// solved one by one, otherwise they are split into islands that are
+// solved concurrently. A body only ever shows up in the pairs of one
+// island and the islands keep the order of the pairs, so every body
+// goes through the same pairs in the same order either way and the
+// result does not depend on the number of threads.
+static int rigid_bodies_collide_passes(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    bool collision = true;
+
+    for (size_t pass = 0; pass < RIGID_BODIES_MAX_PASSES && collision; ++pass) {
+        collision = false;
+
+        if (rigid_bodies_find_active_pairs(rigid_bodies) < 0) {
+            return -1;
+        }
+
+        if (rigid_bodies->thread_pool == NULL) {
+            rigid_bodies_solve_pairs(rigid_bodies, &collision);
+        } else if (rigid_bodies_solve_islands(rigid_bodies, &collision) < 0) {
+            return -1;
         }
     }
 
-    size_t *collided = hashset_values(rigid_bodies->collided);
-    const size_t n = hashset_count(rigid_bodies->collided);
+    return 0;
+}
+
+static int rigid_bodies_collide_with_itself(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    if (rigid_bodies->count == 0) {
+        return 0;
+    }
+
+    // The contacts of this collision become the previous ones
+    PairTable *collided = rigid_bodies->collided;
+    rigid_bodies->collided = rigid_bodies->prev_collided;
+    rigid_bodies->prev_collided = collided;
+
+    Contact *contacts = rigid_bodies->contacts;
+    rigid_bodies->contacts = rigid_bodies->prev_contacts;
+    rigid_bodies->prev_contacts = contacts;
+
+    const size_t contacts_capacity = rigid_bodies->contacts_capacity;
+    rigid_bodies->contacts_capacity = rigid_bodies->prev_contacts_capacity;
+    rigid_bodies->prev_contacts_capacity = contacts_capacity;
+
+    pair_table_clear(rigid_bodies->collided);
+
+    rigid_bodies->candidates_count = 0;
+    rigid_bodies->overlaps_count = 0;
+
+    if (rigid_bodies_collide_passes(rigid_bodies) < 0) {
+        return -1;
+    }
+
+    const size_t n = pair_table_count(rigid_bodies->collided);
     for (size_t i = 0; i < n; ++i) {
-        const size_t i1 = *(collided + i * 2);
-        const size_t i2 = *(collided + i * 2 + 1);
+        size_t i1, i2;
+        pair_table_at(rigid_bodies->collided, i, &i1, &i2);
 
-        rigid_bodies_apply_force(
+        rigid_bodies_apply_force_at(
             rigid_bodies, i1, vec_sum(rigid_bodies->velocities[i2], rigid_bodies->movements[i2]));
-        rigid_bodies_apply_force(
+        rigid_bodies_apply_force_at(
             rigid_bodies, i2, vec_sum(rigid_bodies->velocities[i1], rigid_bodies->movements[i1]));
     }
 
     return 0;
 }
 
+static void rigid_bodies_collide_body_with_platforms(
+    RigidBodies *rigid_bodies,
+    const Platforms *platforms,
+    size_t i)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(platforms);
+
+    if (rigid_bodies->disabled[i] || !rigid_bodies->dirty[i]) {
+        return;
+    }
+
+    int sides[RECT_SIDE_N] = { 0, 0, 0, 0 };
+
+    platforms_touches_rect_sides(platforms, rigid_bodies->bodies[i], sides);
+
+    if (sides[RECT_SIDE_BOTTOM]) {
+        rigid_bodies->grounded[i] = true;
+    }
+
+    Vec v = platforms_snap_rect(platforms, &rigid_bodies->bodies[i]);
+    rigid_bodies->velocities[i] = vec_entry_mult(rigid_bodies->velocities[i], v);
+    rigid_bodies->movements[i] = vec_entry_mult(rigid_bodies->movements[i], v);
+    rigid_bodies_damper_at(rigid_bodies, i, vec_entry_mult(v, vec(-16.0f, 0.0f)));
+}
+
+typedef struct {
+    RigidBodies *rigid_bodies;
+    const Platforms *platforms;
+} PlatformsJob;
+
+// ThreadPoolJob. Every body is snapped independently from the others.
+static void rigid_bodies_collide_chunk_with_platforms(void *context, size_t index)
+{
+    PlatformsJob *job = context;
+    trace_assert(job);
+
+    const size_t begin = index * RIGID_BODIES_PLATFORMS_JOB_SIZE;
+    size_t end = begin + RIGID_BODIES_PLATFORMS_JOB_SIZE;
+    if (end > job->rigid_bodies->count) {
+        end = job->rigid_bodies->count;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        rigid_bodies_collide_body_with_platforms(job->rigid_bodies, job->platforms, i);
+    }
+}
+
 static int rigid_bodies_collide_with_platforms(
     RigidBodies *rigid_bodies,
     const Platforms *platforms)
@@ -173,35 +997,101 @@ static int rigid_bodies_collide_with_platforms(
     trace_assert(rigid_bodies);
     trace_assert(platforms);
 
-    int sides[RECT_SIDE_N] = { 0, 0, 0, 0 };
+    PlatformsJob job = {
+        .rigid_bodies = rigid_bodies,
+        .platforms = platforms
+    };
+
+    thread_pool_run(
+        rigid_bodies->thread_pool,
+        rigid_bodies_collide_chunk_with_platforms,
+        &job,
+        (rigid_bodies->count + RIGID_BODIES_PLATFORMS_JOB_SIZE - 1) / RIGID_BODIES_PLATFORMS_JOB_SIZE);
+
+    return 0;
+}
+
+// Stops the bodies that moved through a platform during the last step
+// at the platform, so they don't tunnel through the thin ones
+static void rigid_bodies_sweep_with_platforms(
+    RigidBodies *rigid_bodies,
+    const Platforms *platforms)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(platforms);
+
+    rigid_bodies->swept_count = 0;
 
     for (size_t i = 0; i < rigid_bodies->count; ++i) {
-        if (rigid_bodies->deleted[i] || rigid_bodies->disabled[i]) {
+        if (rigid_bodies->disabled[i] || !rigid_bodies->dirty[i]) {
             continue;
         }
 
-        memset(sides, 0, sizeof(int) * RECT_SIDE_N);
+        const Vec prev = rigid_bodies->prev_positions[i];
+        Rect body = rigid_bodies->bodies[i];
+        const Vec displacement = vec(body.x - prev.x, body.y - prev.y);
+        body.x = prev.x;
+        body.y = prev.y;
 
-        platforms_touches_rect_sides(platforms, rigid_bodies->bodies[i], sides);
+        if (platforms_sweep_rect(platforms, &body, displacement)) {
+            rigid_bodies->bodies[i].x = body.x;
+            rigid_bodies->bodies[i].y = body.y;
+            rigid_bodies->swept_count++;
+        }
+    }
+}
 
-        if (sides[RECT_SIDE_BOTTOM]) {
-            rigid_bodies->grounded[i] = true;
+// Puts to sleep the bodies that were at rest for long enough
+static void rigid_bodies_update_sleep(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    rigid_bodies->asleep_count = 0;
+
+    for (size_t i = 0; i < rigid_bodies->count; ++i) {
+        if (rigid_bodies->disabled[i]) {
+            continue;
         }
 
-        Vec v = platforms_snap_rect(platforms, &rigid_bodies->bodies[i]);
-        rigid_bodies->velocities[i] = vec_entry_mult(rigid_bodies->velocities[i], v);
-        rigid_bodies->movements[i] = vec_entry_mult(rigid_bodies->movements[i], v);
-        rigid_bodies_damper(rigid_bodies, i, vec_entry_mult(v, vec(-16.0f, 0.0f)));
-    }
+        if (rigid_bodies->asleep[i]) {
+            rigid_bodies->asleep_count++;
+            continue;
+        }
 
-    return 0;
+        if (vec_length(rigid_bodies->velocities[i]) < RIGID_BODIES_SLEEP_VELOCITY
+            && vec_length(rigid_bodies->movements[i]) < RIGID_BODIES_SLEEP_VELOCITY
+            && vec_length(rigid_bodies->forces[i]) < RIGID_BODIES_SLEEP_FORCE) {
+            rigid_bodies->still_ticks[i]++;
+        } else {
+            rigid_bodies->still_ticks[i] = 0;
+        }
+
+        if (rigid_bodies->still_ticks[i] >= RIGID_BODIES_SLEEP_TICKS) {
+            rigid_bodies->asleep[i] = true;
+            rigid_bodies->velocities[i] = vec(0.0f, 0.0f);
+            rigid_bodies->forces[i] = vec(0.0f, 0.0f);
+            rigid_bodies->asleep_count++;
+        }
+    }
 }
 
 int rigid_bodies_collide(RigidBodies *rigid_bodies,
                          const Platforms *platforms)
 {
-    // TODO(#683): RigidBodies should collide only the bodies that were updated on after a previous collision
-    memset(rigid_bodies->grounded, 0, sizeof(bool) * rigid_bodies->count);
+    trace_assert(rigid_bodies);
+    trace_assert(platforms);
+
+    // The bodies that did not move keep their grounded state from
+    // the previous collision
+    rigid_bodies->dirty_count = 0;
+    for (size_t i = 0; i < rigid_bodies->count; ++i) {
+        if (rigid_bodies->dirty[i]) {
+            rigid_bodies->grounded[i] = false;
+            rigid_bodies->dirty_count++;
+        }
+    }
+
+    rigid_bodies_sweep_with_platforms(rigid_bodies, platforms);
 
     if (rigid_bodies_collide_with_itself(rigid_bodies) < 0) {
         return -1;
@@ -211,19 +1101,17 @@ int rigid_bodies_collide(RigidBodies *rigid_bodies,
         return -1;
     }
 
+    rigid_bodies_update_sleep(rigid_bodies);
+
+    memset(rigid_bodies->dirty, 0, sizeof(bool) * rigid_bodies->count);
+
     return 0;
 }
 
-int rigid_bodies_update(RigidBodies *rigid_bodies,
-                        RigidBodyId id,
-                        float delta_time)
+static void rigid_bodies_integrate(RigidBodies *rigid_bodies,
+                                   size_t id,
+                                   float delta_time)
 {
-    trace_assert(rigid_bodies);
-
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
-        return 0;
-    }
-
     rigid_bodies->velocities[id] = vec_sum(
             rigid_bodies->velocities[id],
             vec_scala_mult(
@@ -241,12 +1129,107 @@ int rigid_bodies_update(RigidBodies *rigid_bodies,
                 rigid_bodies->movements[id]),
             delta_time));
 
-    rigid_bodies->bodies[id].x = position.x;
-    rigid_bodies->bodies[id].y = position.y;
+    if (position.x != rigid_bodies->bodies[id].x ||
+        position.y != rigid_bodies->bodies[id].y) {
+        rigid_bodies->bodies[id].x = position.x;
+        rigid_bodies->bodies[id].y = position.y;
+        rigid_bodies->dirty[id] = true;
+    }
 
     rigid_bodies->forces[id] = vec(0.0f, 0.0f);
+}
 
-    return 0;
+#ifdef RIGID_BODIES_SSE2
+// Integrates the bodies i and i + 1. Every register holds both
+// components of a vector for two bodies: (x0, y0, x1, y1).
+static void rigid_bodies_integrate_sse2(RigidBodies *rigid_bodies,
+                                        size_t i,
+                                        __m128 dt)
+{
+    const __m128i m = _mm_loadl_epi64((const __m128i *) (rigid_bodies->live_mask + i));
+    const __m128 mask = _mm_castsi128_ps(_mm_unpacklo_epi32(m, m));
+
+    float *velocities = &rigid_bodies->velocities[i].x;
+    float *forces = &rigid_bodies->forces[i].x;
+    const float *movements = &rigid_bodies->movements[i].x;
+
+    const __m128 f = _mm_loadu_ps(forces);
+    const __m128 v = _mm_loadu_ps(velocities);
+    const __m128 v1 = _mm_add_ps(v, _mm_mul_ps(f, dt));
+
+    // Rect is (x, y, w, h), so the positions have to be gathered
+    const __m128 r0 = _mm_loadu_ps(&rigid_bodies->bodies[i].x);
+    const __m128 r1 = _mm_loadu_ps(&rigid_bodies->bodies[i + 1].x);
+    const __m128 p = _mm_movelh_ps(r0, r1);
+    const __m128 p1 = _mm_add_ps(
+        p,
+        _mm_mul_ps(_mm_add_ps(v1, _mm_loadu_ps(movements)), dt));
+
+    const __m128 new_v = _mm_or_ps(_mm_and_ps(mask, v1), _mm_andnot_ps(mask, v));
+    const __m128 new_p = _mm_or_ps(_mm_and_ps(mask, p1), _mm_andnot_ps(mask, p));
+
+    _mm_storeu_ps(velocities, new_v);
+    _mm_storeu_ps(forces, _mm_andnot_ps(mask, f));
+    _mm_storeu_ps(&rigid_bodies->bodies[i].x, _mm_shuffle_ps(new_p, r0, _MM_SHUFFLE(3, 2, 1, 0)));
+    _mm_storeu_ps(&rigid_bodies->bodies[i + 1].x, _mm_shuffle_ps(new_p, r1, _MM_SHUFFLE(3, 2, 3, 2)));
+
+    const int moved = _mm_movemask_ps(_mm_cmpneq_ps(new_p, p));
+    rigid_bodies->dirty[i] = rigid_bodies->dirty[i] || (moved & 0x3);
+    rigid_bodies->dirty[i + 1] = rigid_bodies->dirty[i + 1] || (moved & 0xC);
+}
+#endif
+
+void rigid_bodies_integrate_all(RigidBodies *rigid_bodies,
+                                float delta_time)
+{
+    trace_assert(rigid_bodies);
+
+    for (size_t i = 0; i < rigid_bodies->count; ++i) {
+        rigid_bodies->prev_positions[i] = vec(rigid_bodies->bodies[i].x, rigid_bodies->bodies[i].y);
+    }
+
+    for (size_t i = 0; i < rigid_bodies->count; ++i) {
+        rigid_bodies->live_mask[i] = (uint32_t) 0 - (uint32_t) !(
+            rigid_bodies->disabled[i]
+            | rigid_bodies->asleep[i]);
+    }
+
+    size_t i = 0;
+
+#ifdef RIGID_BODIES_SSE2
+    const __m128 dt = _mm_set1_ps(delta_time);
+    for (; i + 1 < rigid_bodies->count; i += 2) {
+        rigid_bodies_integrate_sse2(rigid_bodies, i, dt);
+    }
+#endif
+
+    for (; i < rigid_bodies->count; ++i) {
+        if (rigid_bodies->live_mask[i]) {
+            rigid_bodies_integrate(rigid_bodies, i, delta_time);
+        }
+    }
+}
+
+static Rect rigid_bodies_interpolated_rect(const RigidBodies *rigid_bodies,
+                                          size_t slot)
+{
+    trace_assert(rigid_bodies);
+
+    const Rect body = rigid_bodies->bodies[slot];
+    const Vec prev = rigid_bodies->prev_positions[slot];
+    const float alpha = rigid_bodies->alpha;
+
+    return rect(
+        prev.x + (body.x - prev.x) * alpha,
+        prev.y + (body.y - prev.y) * alpha,
+        body.w, body.h);
+}
+
+void rigid_bodies_interpolate(RigidBodies *rigid_bodies, float alpha)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(0.0f <= alpha && alpha <= 1.0f);
+    rigid_bodies->alpha = alpha;
 }
 
 int rigid_bodies_render(RigidBodies *rigid_bodies,
@@ -257,93 +1240,289 @@ int rigid_bodies_render(RigidBodies *rigid_bodies,
     trace_assert(rigid_bodies);
     trace_assert(camera);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot) || rigid_bodies->disabled[slot]) {
         return 0;
     }
 
     char text_buffer[256];
+    const Rect body = rigid_bodies_interpolated_rect(rigid_bodies, slot);
+
+    if (!camera_is_rect_visible(camera, body)) {
+        return 0;
+    }
 
     if (camera_fill_rect(
             camera,
-            rigid_bodies->bodies[id],
+            body,
             color) < 0) {
         return -1;
     }
 
-    snprintf(text_buffer, 256, "id: %zd", id);
+    snprintf(text_buffer, 256, "id: %zu gen: %zu",
+             (size_t) (id & RIGID_BODIES_ID_INDEX_MASK),
+             (size_t) (id >> RIGID_BODIES_ID_INDEX_BITS));
 
     if (camera_render_debug_text(
             camera,
             text_buffer,
-            vec(rigid_bodies->bodies[id].x,
-                rigid_bodies->bodies[id].y)) < 0) {
+            vec(body.x,
+                body.y)) < 0) {
         return -1;
     }
 
     snprintf(text_buffer, 256, "p:(%.2f, %.2f)",
-             rigid_bodies->bodies[id].x,
-             rigid_bodies->bodies[id].y);
+             rigid_bodies->bodies[slot].x,
+             rigid_bodies->bodies[slot].y);
     if (camera_render_debug_text(
             camera,
             text_buffer,
-            vec(rigid_bodies->bodies[id].x,
-                rigid_bodies->bodies[id].y + FONT_CHAR_HEIGHT * 2.0f))) {
+            vec(body.x,
+                body.y + FONT_CHAR_HEIGHT * 2.0f))) {
         return -1;
     }
 
     snprintf(text_buffer, 256, "v:(%.2f, %.2f)",
-             rigid_bodies->velocities[id].x,
-             rigid_bodies->velocities[id].y);
+             rigid_bodies->velocities[slot].x,
+             rigid_bodies->velocities[slot].y);
     if (camera_render_debug_text(
             camera,
             text_buffer,
-            vec(rigid_bodies->bodies[id].x,
-                rigid_bodies->bodies[id].y + FONT_CHAR_HEIGHT * 4.0f))) {
+            vec(body.x,
+                body.y + FONT_CHAR_HEIGHT * 4.0f))) {
         return -1;
     }
 
     snprintf(text_buffer, 256, "m:(%.2f, %.2f)",
-             rigid_bodies->movements[id].x,
-             rigid_bodies->movements[id].y);
+             rigid_bodies->movements[slot].x,
+             rigid_bodies->movements[slot].y);
+    if (camera_render_debug_text(
+            camera,
+            text_buffer,
+            vec(body.x,
+                body.y + FONT_CHAR_HEIGHT * 6.0f))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int rigid_bodies_render_stats(const RigidBodies *rigid_bodies,
+                              Camera *camera)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(camera);
+
+    char text_buffer[256];
+    const Rect view_port = camera_view_port(camera);
+
+    snprintf(text_buffer, 256, "collision: %zu bodies, %zu asleep, %zu moved, %zu candidates, %zu overlaps, %zu swept",
+             rigid_bodies->count,
+             rigid_bodies->asleep_count,
+             rigid_bodies->dirty_count,
+             rigid_bodies->candidates_count,
+             rigid_bodies->overlaps_count,
+             rigid_bodies->swept_count);
+
     if (camera_render_debug_text(
             camera,
             text_buffer,
-            vec(rigid_bodies->bodies[id].x,
-                rigid_bodies->bodies[id].y + FONT_CHAR_HEIGHT * 6.0f))) {
+            vec(view_port.x + 10.0f, view_port.y + 10.0f)) < 0) {
         return -1;
     }
 
     return 0;
 }
 
+// Reallocates `array` of `old_capacity` elements to `new_capacity`
+// elements and zeros the new ones. Returns NULL on failure leaving
+// `array` untouched.
+static void *rigid_bodies_grow_array(RigidBodies *rigid_bodies,
+                                     void *array,
+                                     size_t element_size,
+                                     size_t old_capacity,
+                                     size_t new_capacity)
+{
+    trace_assert(rigid_bodies);
+    trace_assert(array);
+    trace_assert(old_capacity < new_capacity);
+
+    char *new_array = nth_realloc(array, new_capacity * element_size);
+    if (new_array == NULL) {
+        return NULL;
+    }
+
+    memset(new_array + old_capacity * element_size,
+           0,
+           (new_capacity - old_capacity) * element_size);
+
+    return REPLACE_LT(rigid_bodies->lt, array, new_array);
+}
+
+#define RIGID_BODIES_GROW(rigid_bodies, array, new_capacity)            \
+    do {                                                                \
+        void *new_array = rigid_bodies_grow_array(                      \
+            rigid_bodies,                                               \
+            rigid_bodies->array,                                        \
+            sizeof(rigid_bodies->array[0]),                             \
+            rigid_bodies->capacity,                                     \
+            new_capacity);                                              \
+        if (new_array == NULL) {                                        \
+            return -1;                                                  \
+        }                                                               \
+        rigid_bodies->array = new_array;                                \
+    } while (0)
+
+// The ids are resolved through the handle table, so they survive the
+// reallocation
+static int rigid_bodies_grow(RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    if (rigid_bodies->capacity >= RIGID_BODIES_MAX_CAPACITY) {
+        log_fail("Could not add more than %zu rigid bodies\n",
+                 (size_t) RIGID_BODIES_MAX_CAPACITY);
+        return -1;
+    }
+
+    size_t new_capacity = rigid_bodies->capacity * 2;
+    if (new_capacity > RIGID_BODIES_MAX_CAPACITY) {
+        new_capacity = RIGID_BODIES_MAX_CAPACITY;
+    }
+
+    RIGID_BODIES_GROW(rigid_bodies, bodies, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, velocities, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, movements, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, grounded, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, forces, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, disabled, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, dirty, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, live_mask, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, prev_positions, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, asleep, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, still_ticks, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, handle_slots, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, handle_generations, new_capacity);
+    RIGID_BODIES_GROW(rigid_bodies, slot_handles, new_capacity);
+
+    rigid_bodies->capacity = new_capacity;
+
+    return 0;
+}
+
 RigidBodyId rigid_bodies_add(RigidBodies *rigid_bodies,
                              Rect rect)
 {
     trace_assert(rigid_bodies);
-    trace_assert(rigid_bodies->count < rigid_bodies->capacity);
 
-    RigidBodyId id = rigid_bodies->count++;
-    rigid_bodies->bodies[id] = rect;
+    if (rigid_bodies->count >= rigid_bodies->capacity
+        && rigid_bodies_grow(rigid_bodies) < 0) {
+        return RIGID_BODIES_NO_ID;
+    }
+
+    // There are never more handles than live bodies plus free
+    // handles, so the handle table fits into the capacity as well
+    size_t handle;
+    if (dynarray_count(rigid_bodies->free_handles) > 0) {
+        dynarray_pop(rigid_bodies->free_handles, &handle);
+    } else {
+        handle = rigid_bodies->handles_count++;
+    }
+
+    const size_t slot = rigid_bodies->count++;
+    rigid_bodies->handle_slots[handle] = slot;
+    rigid_bodies->slot_handles[slot] = handle;
+
+    rigid_bodies->bodies[slot] = rect;
+    rigid_bodies->prev_positions[slot] = vec(rect.x, rect.y);
+    rigid_bodies->velocities[slot] = vec(0.0f, 0.0f);
+    rigid_bodies->movements[slot] = vec(0.0f, 0.0f);
+    rigid_bodies->forces[slot] = vec(0.0f, 0.0f);
+    rigid_bodies->grounded[slot] = false;
+    rigid_bodies->disabled[slot] = false;
+    rigid_bodies->dirty[slot] = true;
+    rigid_bodies->asleep[slot] = false;
+    rigid_bodies->still_ticks[slot] = 0;
+
+    if (rigid_bodies->sap && sweep_and_prune_add(rigid_bodies->sap, slot) < 0) {
+        log_fail("Could not add body %zu to the broadphase\n", slot);
+    }
 
-    return id;
+    return (rigid_bodies->handle_generations[handle] << RIGID_BODIES_ID_INDEX_BITS) | handle;
 }
 
 void rigid_bodies_remove(RigidBodies *rigid_bodies,
                          RigidBodyId id)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->capacity);
 
-    rigid_bodies->deleted[id] = true;
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
+        return;
+    }
+
+    if (!rigid_bodies->disabled[slot]) {
+        if (rigid_bodies->sap) {
+            sweep_and_prune_remove(rigid_bodies->sap, slot);
+        }
+
+        rigid_bodies_wake_neighbours(rigid_bodies, slot);
+    }
+
+    const size_t handle = rigid_bodies->slot_handles[slot];
+    rigid_bodies->handle_generations[handle] =
+        (rigid_bodies->handle_generations[handle] + 1) & RIGID_BODIES_ID_GENERATION_MASK;
+    if (dynarray_push(rigid_bodies->free_handles, &handle) < 0) {
+        log_fail("Could not reuse the id of the body %zu\n", id);
+    }
+
+    // The contacts refer to the bodies by their slots
+    pair_table_clear(rigid_bodies->collided);
+    pair_table_clear(rigid_bodies->prev_collided);
+
+    // Moving the last body into the freed slot
+    const size_t last = --rigid_bodies->count;
+    if (slot != last) {
+        rigid_bodies->bodies[slot] = rigid_bodies->bodies[last];
+        rigid_bodies->prev_positions[slot] = rigid_bodies->prev_positions[last];
+        rigid_bodies->velocities[slot] = rigid_bodies->velocities[last];
+        rigid_bodies->movements[slot] = rigid_bodies->movements[last];
+        rigid_bodies->grounded[slot] = rigid_bodies->grounded[last];
+        rigid_bodies->forces[slot] = rigid_bodies->forces[last];
+        rigid_bodies->disabled[slot] = rigid_bodies->disabled[last];
+        rigid_bodies->dirty[slot] = rigid_bodies->dirty[last];
+        rigid_bodies->asleep[slot] = rigid_bodies->asleep[last];
+        rigid_bodies->still_ticks[slot] = rigid_bodies->still_ticks[last];
+
+        rigid_bodies->slot_handles[slot] = rigid_bodies->slot_handles[last];
+        rigid_bodies->handle_slots[rigid_bodies->slot_handles[slot]] = slot;
+
+        if (rigid_bodies->sap && !rigid_bodies->disabled[slot]) {
+            sweep_and_prune_rename(rigid_bodies->sap, last, slot);
+        }
+    }
+}
+
+Rect rigid_bodies_interpolated_hitbox(const RigidBodies *rigid_bodies,
+                                      RigidBodyId id)
+{
+    trace_assert(rigid_bodies);
+
+    size_t slot = 0;
+    trace_assert(rigid_bodies_slot(rigid_bodies, id, &slot));
+
+    return rigid_bodies_interpolated_rect(rigid_bodies, slot);
 }
 
 Rect rigid_bodies_hitbox(const RigidBodies *rigid_bodies,
                          RigidBodyId id)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    return rigid_bodies->bodies[id];
+    size_t slot = 0;
+    trace_assert(rigid_bodies_slot(rigid_bodies, id, &slot));
+
+    return rigid_bodies->bodies[slot];
 }
 
 void rigid_bodies_move(RigidBodies *rigid_bodies,
@@ -351,29 +1530,54 @@ void rigid_bodies_move(RigidBodies *rigid_bodies,
                        Vec movement)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot) || rigid_bodies->disabled[slot]) {
         return;
     }
 
-    rigid_bodies->movements[id] = movement;
+    if (rigid_bodies->movements[slot].x != movement.x ||
+        rigid_bodies->movements[slot].y != movement.y) {
+        rigid_bodies->movements[slot] = movement;
+        rigid_bodies->dirty[slot] = true;
+        rigid_bodies_wake(rigid_bodies, slot);
+    }
+}
+
+bool rigid_bodies_asleep(const RigidBodies *rigid_bodies,
+                         RigidBodyId id)
+{
+    trace_assert(rigid_bodies);
+
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
+        return false;
+    }
+
+    return rigid_bodies->asleep[slot];
 }
 
 int rigid_bodies_touches_ground(const RigidBodies *rigid_bodies,
                                 RigidBodyId id)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    return rigid_bodies->grounded[id];
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
+        return 0;
+    }
+
+    return rigid_bodies->grounded[slot];
 }
 
 void rigid_bodies_apply_omniforce(RigidBodies *rigid_bodies,
                                   Vec force)
 {
     for (size_t i = 0; i < rigid_bodies->count; ++i) {
-        rigid_bodies_apply_force(rigid_bodies, i, force);
+        // The sleeping bodies are already at rest under the omniforce
+        if (!rigid_bodies->asleep[i]) {
+            rigid_bodies_apply_force_at(rigid_bodies, i, force);
+        }
     }
 }
 
@@ -382,13 +1586,13 @@ void rigid_bodies_apply_force(RigidBodies * rigid_bodies,
                               Vec force)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
         return;
     }
 
-    rigid_bodies->forces[id] = vec_sum(rigid_bodies->forces[id], force);
+    rigid_bodies_apply_force_at(rigid_bodies, slot, force);
 }
 
 void rigid_bodies_transform_velocity(RigidBodies *rigid_bodies,
@@ -396,15 +1600,21 @@ void rigid_bodies_transform_velocity(RigidBodies *rigid_bodies,
                                      mat3x3 trans_mat)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot) || rigid_bodies->disabled[slot]) {
         return;
     }
 
-    rigid_bodies->velocities[id] = point_mat3x3_product(
-        rigid_bodies->velocities[id],
+    const Vec velocity = point_mat3x3_product(
+        rigid_bodies->velocities[slot],
         trans_mat);
+
+    if (velocity.x != rigid_bodies->velocities[slot].x ||
+        velocity.y != rigid_bodies->velocities[slot].y) {
+        rigid_bodies->velocities[slot] = velocity;
+        rigid_bodies_wake(rigid_bodies, slot);
+    }
 }
 
 void rigid_bodies_teleport_to(RigidBodies *rigid_bodies,
@@ -412,14 +1622,20 @@ void rigid_bodies_teleport_to(RigidBodies *rigid_bodies,
                               Vec position)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot) || rigid_bodies->disabled[slot]) {
         return;
     }
 
-    rigid_bodies->bodies[id].x = position.x;
-    rigid_bodies->bodies[id].y = position.y;
+    rigid_bodies_wake_neighbours(rigid_bodies, slot);
+
+    rigid_bodies->bodies[slot].x = position.x;
+    rigid_bodies->bodies[slot].y = position.y;
+    // Teleportation is not supposed to be smooth
+    rigid_bodies->prev_positions[slot] = position;
+    rigid_bodies->dirty[slot] = true;
+    rigid_bodies_wake(rigid_bodies, slot);
 }
 
 void rigid_bodies_damper(RigidBodies *rigid_bodies,
@@ -427,17 +1643,13 @@ void rigid_bodies_damper(RigidBodies *rigid_bodies,
                          Vec v)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    if (rigid_bodies->deleted[id] || rigid_bodies->disabled[id]) {
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
         return;
     }
 
-    rigid_bodies_apply_force(
-        rigid_bodies, id,
-        vec(
-            rigid_bodies->velocities[id].x * v.x,
-            rigid_bodies->velocities[id].y * v.y));
+    rigid_bodies_damper_at(rigid_bodies, slot, v);
 }
 
 void rigid_bodies_disable(RigidBodies *rigid_bodies,
@@ -445,7 +1657,58 @@ void rigid_bodies_disable(RigidBodies *rigid_bodies,
                           bool disabled)
 {
     trace_assert(rigid_bodies);
-    trace_assert(id < rigid_bodies->count);
 
-    rigid_bodies->disabled[id] = disabled;
+    size_t slot;
+    if (!rigid_bodies_slot(rigid_bodies, id, &slot)) {
+        return;
+    }
+
+    if (rigid_bodies->sap && rigid_bodies->disabled[slot] != disabled) {
+        if (disabled) {
+            sweep_and_prune_remove(rigid_bodies->sap, slot);
+        } else if (sweep_and_prune_add(rigid_bodies->sap, slot) < 0) {
+            log_fail("Could not add body %zu to the broadphase\n", slot);
+        }
+    }
+
+    if (disabled && !rigid_bodies->disabled[slot]) {
+        rigid_bodies_wake_neighbours(rigid_bodies, slot);
+    }
+
+    rigid_bodies->disabled[slot] = disabled;
+    rigid_bodies->dirty[slot] = true;
+    rigid_bodies_wake(rigid_bodies, slot);
+}
+
+// FNV-1a
+static uint64_t rigid_bodies_hash(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t rigid_bodies_checksum(const RigidBodies *rigid_bodies)
+{
+    trace_assert(rigid_bodies);
+
+    uint64_t hash = 14695981039346656037ULL;
+    hash = rigid_bodies_hash(hash, &rigid_bodies->count, sizeof(rigid_bodies->count));
+    hash = rigid_bodies_hash(hash, rigid_bodies->bodies,
+                             rigid_bodies->count * sizeof(Rect));
+    hash = rigid_bodies_hash(hash, rigid_bodies->velocities,
+                             rigid_bodies->count * sizeof(Vec));
+    hash = rigid_bodies_hash(hash, rigid_bodies->movements,
+                             rigid_bodies->count * sizeof(Vec));
+    hash = rigid_bodies_hash(hash, rigid_bodies->forces,
+                             rigid_bodies->count * sizeof(Vec));
+    hash = rigid_bodies_hash(hash, rigid_bodies->grounded,
+                             rigid_bodies->count * sizeof(bool));
+    hash = rigid_bodies_hash(hash, rigid_bodies->disabled,
+                             rigid_bodies->count * sizeof(bool));
+
+    return hash;
 }
@@ -1,39 +1,79 @@
 #ifndef RIGID_BODIES_H_
 #define RIGID_BODIES_H_
 
+#include <stdint.h>
+
 typedef struct RigidBodies RigidBodies;
 typedef struct Camera Camera;
 typedef struct Platforms Platforms;
 typedef struct LineStream LineStream;
 
+// An opaque handle. Stays valid until the body is removed and is never
+// given to another body after that.
 typedef size_t RigidBodyId;
 
-RigidBodies *create_rigid_bodies(size_t capacity);
+// Returned by rigid_bodies_add() when the body could not be added
+#define RIGID_BODIES_NO_ID ((RigidBodyId) -1)
+
+typedef enum {
+    BROADPHASE_ALL_PAIRS = 0,
+    BROADPHASE_UNIFORM_GRID,
+    BROADPHASE_SWEEP_AND_PRUNE
+} BroadphaseType;
+
+RigidBodies *create_rigid_bodies(size_t capacity,
+                                 BroadphaseType broadphase);
 void destroy_rigid_bodies(RigidBodies *rigid_bodies);
 
+// Makes rigid_bodies_collide() split the bodies into the groups that
+// can't touch each other and solve the groups on `threads_count`
+// threads. The result does not depend on `threads_count`. 0 switches
+// back to solving the pairs one by one on the calling thread without
+// splitting them.
+int rigid_bodies_set_island_threads(RigidBodies *rigid_bodies,
+                                    size_t threads_count);
+
 int rigid_bodies_collide(RigidBodies *rigid_bodies,
                          const Platforms *platforms);
 
-int rigid_bodies_update(RigidBodies *rigid_bodies,
-                        RigidBodyId id,
-                        float delta_time);
+// Integrates all of the live bodies at once
+void rigid_bodies_integrate_all(RigidBodies *rigid_bodies,
+                                float delta_time);
 
+// Sets how far the rendering is between the previous physics step
+// (0.0f) and the current one (1.0f)
+void rigid_bodies_interpolate(RigidBodies *rigid_bodies, float alpha);
 int rigid_bodies_render(RigidBodies *rigid_bodies,
                         RigidBodyId id,
                         Color color,
                         Camera *camera);
+int rigid_bodies_render_stats(const RigidBodies *rigid_bodies,
+                              Camera *camera);
 RigidBodyId rigid_bodies_add(RigidBodies *rigid_bodies,
                              Rect rect);
 void rigid_bodies_remove(RigidBodies *rigid_bodies,
                          RigidBodyId id);
+// False for the ids of the removed bodies, even if their slot was
+// reused by another body since then
+bool rigid_bodies_exists(const RigidBodies *rigid_bodies,
+                         RigidBodyId id);
 
 Rect rigid_bodies_hitbox(const RigidBodies *rigid_bodies,
                          RigidBodyId id);
+// The hitbox the body is rendered at. See rigid_bodies_interpolate()
+Rect rigid_bodies_interpolated_hitbox(const RigidBodies *rigid_bodies,
+                                      RigidBodyId id);
 
 void rigid_bodies_move(RigidBodies *rigid_bodies,
                        RigidBodyId id,
                        Vec movement);
 
+// A body falls asleep after it stays at rest for a while. It is not
+// integrated and not pulled by the omniforce until something wakes it
+// up: a force, a movement or a body that pushes it.
+bool rigid_bodies_asleep(const RigidBodies *rigid_bodies,
+                         RigidBodyId id);
+
 int rigid_bodies_touches_ground(const RigidBodies *rigid_bodies,
                                 RigidBodyId id);
 
@@ -60,4 +100,8 @@ void rigid_bodies_disable(RigidBodies *rigid_bodies,
                           RigidBodyId id,
                           bool disabled);
 
+// Hash of the state of all of the live bodies. Two runs that end up
+// with the same bodies in the same places have the same checksum.
+uint64_t rigid_bodies_checksum(const RigidBodies *rigid_bodies);
+
 #endif  // RIGID_BODIES_H_
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./islands.h"
+
+#define ISLANDS_NONE SIZE_MAX
+
+struct Islands
+{
+    Lt *lt;
+
+    // Union-find over the ids
+    size_t *parents;
+    // The island of each root id
+    size_t *root_islands;
+    size_t ids_capacity;
+
+    // The pair indices grouped by island
+    size_t *pairs;
+    // The island of each pair
+    size_t *pair_islands;
+    size_t pairs_capacity;
+
+    // Island i owns pairs[offsets[i]..offsets[i + 1])
+    size_t *offsets;
+    size_t offsets_capacity;
+    size_t count;
+};
+
+Islands *create_islands(void)
+{
+    Lt *lt = create_lt();
+
+    Islands *islands = PUSH_LT(lt, nth_calloc(1, sizeof(Islands)), free);
+    if (islands == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    islands->lt = lt;
+
+    islands->offsets_capacity = 1;
+    islands->offsets = PUSH_LT(lt, nth_calloc(1, sizeof(size_t)), free);
+    if (islands->offsets == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    return islands;
+}
+
+void destroy_islands(Islands *islands)
+{
+    trace_assert(islands);
+    RETURN_LT0(islands->lt);
+}
+
+// Reallocates `*array` to hold `capacity` elements
+static int islands_reserve(Islands *islands, size_t **array, size_t capacity)
+{
+    trace_assert(islands);
+    trace_assert(array);
+
+    size_t *new_array = nth_realloc(*array, capacity * sizeof(size_t));
+    if (new_array == NULL) {
+        return -1;
+    }
+
+    if (*array == NULL) {
+        *array = PUSH_LT(islands->lt, new_array, free);
+    } else {
+        *array = REPLACE_LT(islands->lt, *array, new_array);
+    }
+
+    return 0;
+}
+
+static size_t islands_find(Islands *islands, size_t id)
+{
+    trace_assert(islands);
+
+    // Path halving
+    while (islands->parents[id] != id) {
+        islands->parents[id] = islands->parents[islands->parents[id]];
+        id = islands->parents[id];
+    }
+
+    return id;
+}
+
+int islands_build(Islands *islands,
+                  const size_t *pairs,
+                  size_t pairs_count,
+                  size_t ids_count)
+{
+    trace_assert(islands);
+    trace_assert(pairs || pairs_count == 0);
+
+    if (ids_count > islands->ids_capacity) {
+        if (islands_reserve(islands, &islands->parents, ids_count) < 0
+            || islands_reserve(islands, &islands->root_islands, ids_count) < 0) {
+            return -1;
+        }
+        islands->ids_capacity = ids_count;
+    }
+
+    if (pairs_count > islands->pairs_capacity) {
+        if (islands_reserve(islands, &islands->pairs, pairs_count) < 0
+            || islands_reserve(islands, &islands->pair_islands, pairs_count) < 0) {
+            return -1;
+        }
+        islands->pairs_capacity = pairs_count;
+    }
+
+    for (size_t id = 0; id < ids_count; ++id) {
+        islands->parents[id] = id;
+        islands->root_islands[id] = ISLANDS_NONE;
+    }
+
+    for (size_t i = 0; i < pairs_count; ++i) {
+        trace_assert(pairs[i * 2] < ids_count);
+        trace_assert(pairs[i * 2 + 1] < ids_count);
+
+        const size_t root1 = islands_find(islands, pairs[i * 2]);
+        const size_t root2 = islands_find(islands, pairs[i * 2 + 1]);
+        if (root1 < root2) {
+            islands->parents[root2] = root1;
+        } else if (root2 < root1) {
+            islands->parents[root1] = root2;
+        }
+    }
+
+    islands->count = 0;
+    for (size_t i = 0; i < pairs_count; ++i) {
+        const size_t root = islands_find(islands, pairs[i * 2]);
+        if (islands->root_islands[root] == ISLANDS_NONE) {
+            islands->root_islands[root] = islands->count++;
+        }
+        islands->pair_islands[i] = islands->root_islands[root];
+    }
+
+    if (islands->count + 1 > islands->offsets_capacity) {
+        if (islands_reserve(islands, &islands->offsets, islands->count + 1) < 0) {
+            return -1;
+        }
+        islands->offsets_capacity = islands->count + 1;
+    }
+
+    // Counting sort of the pairs by their island
+    memset(islands->offsets, 0, (islands->count + 1) * sizeof(size_t));
+    for (size_t i = 0; i < pairs_count; ++i) {
+        islands->offsets[islands->pair_islands[i] + 1]++;
+    }
+    for (size_t i = 1; i <= islands->count; ++i) {
+        islands->offsets[i] += islands->offsets[i - 1];
+    }
+    for (size_t i = 0; i < pairs_count; ++i) {
+        islands->pairs[islands->offsets[islands->pair_islands[i]]++] = i;
+    }
+    // After the previous loop offsets[i] points at the end of the
+    // island i, which is the beginning of the island i + 1
+    memmove(islands->offsets + 1, islands->offsets, islands->count * sizeof(size_t));
+    islands->offsets[0] = 0;
+
+    return 0;
+}
+
+size_t islands_count(const Islands *islands)
+{
+    trace_assert(islands);
+    return islands->count;
+}
+
+void islands_range(const Islands *islands, size_t index,
+                   size_t *begin, size_t *end)
+{
+    trace_assert(islands);
+    trace_assert(index < islands->count);
+    trace_assert(begin);
+    trace_assert(end);
+
+    *begin = islands->offsets[index];
+    *end = islands->offsets[index + 1];
+}
+
+const size_t *islands_pairs(const Islands *islands)
+{
+    trace_assert(islands);
+    return islands->pairs;
+}
@@ -0,0 +1,30 @@
+#ifndef ISLANDS_H_
+#define ISLANDS_H_
+
+#include <stddef.h>
+
+// Splits the pairs of bodies into independent groups: no body appears
+// in the pairs of two different islands
+typedef struct Islands Islands;
+
+Islands *create_islands(void);
+void destroy_islands(Islands *islands);
+
+// `pairs` holds `pairs_count` pairs of ids that are less than
+// `ids_count`, two ids per pair. The islands are numbered in the order
+// of their first pair and their pairs keep the order of `pairs`, so
+// the result does not depend on anything but `pairs`.
+int islands_build(Islands *islands,
+                  const size_t *pairs,
+                  size_t pairs_count,
+                  size_t ids_count);
+
+size_t islands_count(const Islands *islands);
+
+// The indices of the pairs of the island `index` are
+// islands_pairs(islands)[begin..end)
+void islands_range(const Islands *islands, size_t index,
+                   size_t *begin, size_t *end);
+const size_t *islands_pairs(const Islands *islands);
+
+#endif  // ISLANDS_H_
@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./pair_table.h"
+
+#define PAIR_TABLE_MIN_SLOTS 64
+#define PAIR_TABLE_MIN_SLOT_BITS 6
+
+struct PairTable
+{
+    Lt *lt;
+
+    // Open addressing with linear probing. A slot is occupied only if
+    // its generation matches the current generation of the table.
+    uint32_t *keys;
+    uint32_t *generations;
+    // The index of the key of the slot in `pairs`
+    uint32_t *indices;
+    size_t slots_count;
+    // slots_count is 1 << slot_bits
+    unsigned int slot_bits;
+    uint32_t generation;
+
+    // The inserted keys in the order of insertion. Has room for
+    // slots_count / 2 keys, which is the maximum load of the table.
+    uint32_t *pairs;
+    size_t count;
+};
+
+static uint32_t pair_key(size_t i1, size_t i2)
+{
+    trace_assert(i1 <= PAIR_TABLE_MAX_ID);
+    trace_assert(i2 <= PAIR_TABLE_MAX_ID);
+    return ((uint32_t) i1 << 16) | (uint32_t) i2;
+}
+
+static size_t pair_slot(const PairTable *table, uint32_t key)
+{
+    // Fibonacci hashing. The top bits of the product depend on all of
+    // the bits of the key, so both ids of the pair pick the slot.
+    return (size_t) (((uint64_t) key * 0x9E3779B97F4A7C15ull) >> (64 - table->slot_bits));
+}
+
+// Returns true if the key was not in the table. Either way `*index`
+// is the index of the key in `pairs`.
+static bool pair_table_put(PairTable *table, uint32_t key, uint32_t *index)
+{
+    size_t slot = pair_slot(table, key);
+
+    while (table->generations[slot] == table->generation) {
+        if (table->keys[slot] == key) {
+            *index = table->indices[slot];
+            return false;
+        }
+        slot = (slot + 1) & (table->slots_count - 1);
+    }
+
+    table->keys[slot] = key;
+    table->generations[slot] = table->generation;
+    table->indices[slot] = *index;
+    return true;
+}
+
+PairTable *create_pair_table(size_t capacity)
+{
+    Lt *lt = create_lt();
+
+    PairTable *table = PUSH_LT(lt, nth_calloc(1, sizeof(PairTable)), free);
+    if (table == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    table->lt = lt;
+
+    table->slots_count = PAIR_TABLE_MIN_SLOTS;
+    table->slot_bits = PAIR_TABLE_MIN_SLOT_BITS;
+    while (table->slots_count < capacity * 2) {
+        table->slots_count *= 2;
+        table->slot_bits++;
+    }
+    table->generation = 1;
+
+    table->keys = PUSH_LT(lt, nth_calloc(table->slots_count, sizeof(uint32_t)), free);
+    if (table->keys == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    table->generations = PUSH_LT(lt, nth_calloc(table->slots_count, sizeof(uint32_t)), free);
+    if (table->generations == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    table->indices = PUSH_LT(lt, nth_calloc(table->slots_count, sizeof(uint32_t)), free);
+    if (table->indices == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    table->pairs = PUSH_LT(lt, nth_calloc(table->slots_count / 2, sizeof(uint32_t)), free);
+    if (table->pairs == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    return table;
+}
+
+void destroy_pair_table(PairTable *table)
+{
+    trace_assert(table);
+    RETURN_LT0(table->lt);
+}
+
+void pair_table_clear(PairTable *table)
+{
+    trace_assert(table);
+
+    table->count = 0;
+    table->generation++;
+
+    if (table->generation == 0) {
+        memset(table->generations, 0, table->slots_count * sizeof(uint32_t));
+        table->generation = 1;
+    }
+}
+
+static int pair_table_grow(PairTable *table)
+{
+    trace_assert(table);
+
+    const size_t new_slots_count = table->slots_count * 2;
+
+    uint32_t *new_keys = nth_realloc(table->keys, new_slots_count * sizeof(uint32_t));
+    if (new_keys == NULL) {
+        return -1;
+    }
+    table->keys = REPLACE_LT(table->lt, table->keys, new_keys);
+
+    uint32_t *new_generations = nth_realloc(table->generations, new_slots_count * sizeof(uint32_t));
+    if (new_generations == NULL) {
+        return -1;
+    }
+    table->generations = REPLACE_LT(table->lt, table->generations, new_generations);
+
+    uint32_t *new_indices = nth_realloc(table->indices, new_slots_count * sizeof(uint32_t));
+    if (new_indices == NULL) {
+        return -1;
+    }
+    table->indices = REPLACE_LT(table->lt, table->indices, new_indices);
+
+    uint32_t *new_pairs = nth_realloc(table->pairs, new_slots_count / 2 * sizeof(uint32_t));
+    if (new_pairs == NULL) {
+        return -1;
+    }
+    table->pairs = REPLACE_LT(table->lt, table->pairs, new_pairs);
+
+    table->slots_count = new_slots_count;
+    table->slot_bits++;
+    memset(table->generations, 0, table->slots_count * sizeof(uint32_t));
+    table->generation = 1;
+
+    for (size_t i = 0; i < table->count; ++i) {
+        uint32_t index = (uint32_t) i;
+        pair_table_put(table, table->pairs[i], &index);
+    }
+
+    return 0;
+}
+
+int pair_table_insert(PairTable *table, size_t i1, size_t i2, size_t *index)
+{
+    trace_assert(table);
+
+    if ((table->count + 1) * 2 > table->slots_count) {
+        if (pair_table_grow(table) < 0) {
+            return -1;
+        }
+    }
+
+    const uint32_t key = pair_key(i1, i2);
+    uint32_t key_index = (uint32_t) table->count;
+    if (pair_table_put(table, key, &key_index)) {
+        table->pairs[table->count++] = key;
+    }
+
+    if (index != NULL) {
+        *index = key_index;
+    }
+
+    return 0;
+}
+
+bool pair_table_find(const PairTable *table, size_t i1, size_t i2, size_t *index)
+{
+    trace_assert(table);
+
+    const uint32_t key = pair_key(i1, i2);
+    size_t slot = pair_slot(table, key);
+
+    while (table->generations[slot] == table->generation) {
+        if (table->keys[slot] == key) {
+            if (index != NULL) {
+                *index = table->indices[slot];
+            }
+            return true;
+        }
+        slot = (slot + 1) & (table->slots_count - 1);
+    }
+
+    return false;
+}
+
+size_t pair_table_count(const PairTable *table)
+{
+    trace_assert(table);
+    return table->count;
+}
+
+void pair_table_at(const PairTable *table, size_t index,
+                   size_t *i1, size_t *i2)
+{
+    trace_assert(table);
+    trace_assert(index < table->count);
+    trace_assert(i1);
+    trace_assert(i2);
+
+    *i1 = table->pairs[index] >> 16;
+    *i2 = table->pairs[index] & 0xFFFF;
+}
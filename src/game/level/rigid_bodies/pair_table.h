@@ -0,0 +1,33 @@
+#ifndef PAIR_TABLE_H_
+#define PAIR_TABLE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Both ids of a pair are packed into a single 32-bit key
+#define PAIR_TABLE_MAX_ID 0xFFFF
+
+typedef struct PairTable PairTable;
+
+PairTable *create_pair_table(size_t capacity);
+void destroy_pair_table(PairTable *table);
+
+// O(1). The slots are invalidated by bumping the generation instead
+// of wiping the whole table.
+void pair_table_clear(PairTable *table);
+
+// Does nothing if the pair (i1, i2) is already in the table. The pairs
+// (i1, i2) and (i2, i1) are considered different. Sets `*index` to the
+// index of the pair (see pair_table_at()) unless `index` is NULL.
+int pair_table_insert(PairTable *table, size_t i1, size_t i2, size_t *index);
+
+// Looks the pair up without modifying the table, so it's safe to call
+// concurrently as long as nothing is inserted at the same time
+bool pair_table_find(const PairTable *table, size_t i1, size_t i2, size_t *index);
+
+// The pairs are enumerated in the order they were inserted
+size_t pair_table_count(const PairTable *table);
+void pair_table_at(const PairTable *table, size_t index,
+                   size_t *i1, size_t *i2);
+
+#endif  // PAIR_TABLE_H_
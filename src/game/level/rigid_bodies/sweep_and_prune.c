@@ -0,0 +1,126 @@
+#include <stdlib.h>
+
+#include "dynarray.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./sweep_and_prune.h"
+
+struct SweepAndPrune
+{
+    Lt *lt;
+    float margin;
+    // Ids sorted by the left edge of their rects
+    Dynarray *ids;
+};
+
+SweepAndPrune *create_sweep_and_prune(float margin)
+{
+    trace_assert(margin >= 0.0f);
+
+    Lt *lt = create_lt();
+
+    SweepAndPrune *sap = PUSH_LT(lt, nth_calloc(1, sizeof(SweepAndPrune)), free);
+    if (sap == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    sap->lt = lt;
+    sap->margin = margin;
+
+    sap->ids = PUSH_LT(lt, create_dynarray(sizeof(size_t)), destroy_dynarray);
+    if (sap->ids == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    return sap;
+}
+
+void destroy_sweep_and_prune(SweepAndPrune *sap)
+{
+    trace_assert(sap);
+    RETURN_LT0(sap->lt);
+}
+
+int sweep_and_prune_add(SweepAndPrune *sap, size_t id)
+{
+    trace_assert(sap);
+    // The new id is put into its place by the next insertion sort
+    return dynarray_push(sap->ids, &id);
+}
+
+void sweep_and_prune_remove(SweepAndPrune *sap, size_t id)
+{
+    trace_assert(sap);
+
+    const size_t n = dynarray_count(sap->ids);
+    const size_t *ids = dynarray_data(sap->ids);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (ids[i] == id) {
+            dynarray_delete_at(sap->ids, i);
+            return;
+        }
+    }
+}
+
+void sweep_and_prune_rename(SweepAndPrune *sap, size_t old_id, size_t new_id)
+{
+    trace_assert(sap);
+
+    const size_t n = dynarray_count(sap->ids);
+    size_t *ids = dynarray_data(sap->ids);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (ids[i] == old_id) {
+            ids[i] = new_id;
+            return;
+        }
+    }
+}
+
+int sweep_and_prune_pairs(SweepAndPrune *sap,
+                          const Rect *rects,
+                          Dynarray *pairs)
+{
+    trace_assert(sap);
+    trace_assert(rects);
+    trace_assert(pairs);
+
+    const size_t n = dynarray_count(sap->ids);
+    size_t *ids = dynarray_data(sap->ids);
+
+    for (size_t i = 1; i < n; ++i) {
+        const size_t id = ids[i];
+        const float x = rects[id].x;
+
+        size_t j = i;
+        for (; j > 0 && rects[ids[j - 1]].x > x; --j) {
+            ids[j] = ids[j - 1];
+        }
+        ids[j] = id;
+    }
+
+    // Expanding both rects by the margin is the same as expanding
+    // only one of them by the doubled margin
+    const float d = sap->margin * 2.0f;
+
+    size_t pair[2];
+    for (size_t i = 0; i < n; ++i) {
+        const Rect a = rect_scale(rects[ids[i]], d);
+
+        for (size_t j = i + 1; j < n && rects[ids[j]].x < a.x + a.w; ++j) {
+            const Rect b = rects[ids[j]];
+
+            if (b.y + b.h > a.y && a.y + a.h > b.y) {
+                pair[0] = ids[i] < ids[j] ? ids[i] : ids[j];
+                pair[1] = ids[i] < ids[j] ? ids[j] : ids[i];
+                if (dynarray_push(pairs, pair) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
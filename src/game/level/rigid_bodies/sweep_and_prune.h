@@ -0,0 +1,28 @@
+#ifndef SWEEP_AND_PRUNE_H_
+#define SWEEP_AND_PRUNE_H_
+
+#include "math/rect.h"
+
+typedef struct SweepAndPrune SweepAndPrune;
+typedef struct Dynarray Dynarray;
+
+// The rects are expanded by `margin` on every side, so the bodies
+// that barely touch each other are reported as well.
+SweepAndPrune *create_sweep_and_prune(float margin);
+void destroy_sweep_and_prune(SweepAndPrune *sap);
+
+int sweep_and_prune_add(SweepAndPrune *sap, size_t id);
+void sweep_and_prune_remove(SweepAndPrune *sap, size_t id);
+// Keeps the position of the id in the order. Used when the rect
+// itself moves to another index.
+void sweep_and_prune_rename(SweepAndPrune *sap, size_t old_id, size_t new_id);
+
+// Restores the order of the ids by the left edge of their rects and
+// pushes every pair of ids with overlapping expanded rects into `pairs`
+// (element type is `size_t[2]`). The order is kept between the calls,
+// so for the bodies that barely move it is restored in O(N).
+int sweep_and_prune_pairs(SweepAndPrune *sap,
+                          const Rect *rects,
+                          Dynarray *pairs);
+
+#endif  // SWEEP_AND_PRUNE_H_
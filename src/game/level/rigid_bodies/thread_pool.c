@@ -0,0 +1,195 @@
+#include <SDL.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+#include "system/log.h"
+
+#include "./thread_pool.h"
+
+// How many batches of jobs each thread gets on average. Most of the
+// jobs are tiny, so taking them one by one per lock would spend more
+// time on the mutex than on the jobs. A few batches per thread still
+// even out the jobs of different sizes.
+#define THREAD_POOL_BATCHES_PER_THREAD 4
+
+struct ThreadPool
+{
+    Lt *lt;
+
+    SDL_Thread **workers;
+    size_t workers_count;
+
+    // Everything below is guarded by the mutex
+    SDL_mutex *mutex;
+    SDL_cond *work_started;
+    SDL_cond *work_done;
+    bool quit;
+
+    ThreadPoolJob job;
+    void *context;
+    size_t jobs_count;
+    size_t batch_size;
+    size_t next_job;
+    size_t done_jobs;
+};
+
+// Must be called with the mutex locked
+static void thread_pool_work(ThreadPool *pool)
+{
+    trace_assert(pool);
+
+    while (pool->next_job < pool->jobs_count) {
+        const size_t begin = pool->next_job;
+        const size_t end = begin + pool->batch_size < pool->jobs_count
+            ? begin + pool->batch_size
+            : pool->jobs_count;
+        pool->next_job = end;
+        ThreadPoolJob job = pool->job;
+        void *context = pool->context;
+
+        SDL_UnlockMutex(pool->mutex);
+        for (size_t index = begin; index < end; ++index) {
+            job(context, index);
+        }
+        SDL_LockMutex(pool->mutex);
+
+        pool->done_jobs += end - begin;
+        if (pool->done_jobs == pool->jobs_count) {
+            SDL_CondBroadcast(pool->work_done);
+        }
+    }
+}
+
+static int thread_pool_worker(void *data)
+{
+    ThreadPool *pool = data;
+    trace_assert(pool);
+
+    SDL_LockMutex(pool->mutex);
+    while (!pool->quit) {
+        thread_pool_work(pool);
+        SDL_CondWait(pool->work_started, pool->mutex);
+    }
+    SDL_UnlockMutex(pool->mutex);
+
+    return 0;
+}
+
+static void thread_pool_stop(ThreadPool *pool)
+{
+    trace_assert(pool);
+
+    SDL_LockMutex(pool->mutex);
+    pool->quit = true;
+    SDL_CondBroadcast(pool->work_started);
+    SDL_UnlockMutex(pool->mutex);
+
+    for (size_t i = 0; i < pool->workers_count; ++i) {
+        SDL_WaitThread(pool->workers[i], NULL);
+    }
+    pool->workers_count = 0;
+}
+
+ThreadPool *create_thread_pool(size_t threads_count)
+{
+    trace_assert(threads_count > 0);
+
+    Lt *lt = create_lt();
+
+    ThreadPool *pool = PUSH_LT(lt, nth_calloc(1, sizeof(ThreadPool)), free);
+    if (pool == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    pool->lt = lt;
+
+    pool->mutex = PUSH_LT(lt, SDL_CreateMutex(), SDL_DestroyMutex);
+    if (pool->mutex == NULL) {
+        log_fail("Could not create a mutex: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    pool->work_started = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (pool->work_started == NULL) {
+        log_fail("Could not create a condition variable: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    pool->work_done = PUSH_LT(lt, SDL_CreateCond(), SDL_DestroyCond);
+    if (pool->work_done == NULL) {
+        log_fail("Could not create a condition variable: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    pool->workers = PUSH_LT(lt, nth_calloc(threads_count, sizeof(SDL_Thread*)), free);
+    if (pool->workers == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    for (size_t i = 0; i + 1 < threads_count; ++i) {
+        pool->workers[i] = SDL_CreateThread(thread_pool_worker, "ThreadPool", pool);
+        if (pool->workers[i] == NULL) {
+            log_fail("Could not create a thread: %s\n", SDL_GetError());
+            thread_pool_stop(pool);
+            RETURN_LT(lt, NULL);
+        }
+        pool->workers_count++;
+    }
+
+    return pool;
+}
+
+void destroy_thread_pool(ThreadPool *pool)
+{
+    trace_assert(pool);
+    thread_pool_stop(pool);
+    RETURN_LT0(pool->lt);
+}
+
+size_t thread_pool_threads_count(const ThreadPool *pool)
+{
+    trace_assert(pool);
+    return pool->workers_count + 1;
+}
+
+void thread_pool_run(ThreadPool *pool,
+                     ThreadPoolJob job,
+                     void *context,
+                     size_t jobs_count)
+{
+    trace_assert(job);
+
+    if (pool == NULL || pool->workers_count == 0 || jobs_count <= 1) {
+        for (size_t i = 0; i < jobs_count; ++i) {
+            job(context, i);
+        }
+        return;
+    }
+
+    SDL_LockMutex(pool->mutex);
+
+    pool->job = job;
+    pool->context = context;
+    pool->jobs_count = jobs_count;
+    const size_t batches_count =
+        thread_pool_threads_count(pool) * THREAD_POOL_BATCHES_PER_THREAD;
+    pool->batch_size = (jobs_count + batches_count - 1) / batches_count;
+    pool->next_job = 0;
+    pool->done_jobs = 0;
+    SDL_CondBroadcast(pool->work_started);
+
+    thread_pool_work(pool);
+
+    while (pool->done_jobs < pool->jobs_count) {
+        SDL_CondWait(pool->work_done, pool->mutex);
+    }
+
+    pool->job = NULL;
+    pool->context = NULL;
+    pool->jobs_count = 0;
+    pool->next_job = 0;
+
+    SDL_UnlockMutex(pool->mutex);
+}
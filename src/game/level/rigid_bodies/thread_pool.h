@@ -0,0 +1,27 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stddef.h>
+
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ThreadPoolJob)(void *context, size_t index);
+
+// `threads_count` includes the thread that calls thread_pool_run(), so
+// a pool of 1 thread does not start any workers
+ThreadPool *create_thread_pool(size_t threads_count);
+void destroy_thread_pool(ThreadPool *pool);
+
+size_t thread_pool_threads_count(const ThreadPool *pool);
+
+// Calls job(context, index) for every index in [0, jobs_count) and
+// returns when all of them are done. The jobs are picked up by the
+// threads in batches of consecutive indices in an arbitrary order, so
+// they must not depend on each other. NULL `pool` runs all of the jobs
+// on the calling thread.
+void thread_pool_run(ThreadPool *pool,
+                     ThreadPoolJob job,
+                     void *context,
+                     size_t jobs_count);
+
+#endif  // THREAD_POOL_H_
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dynarray.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+
+#include "./uniform_grid.h"
+
+#define UNIFORM_GRID_INIT_BUCKETS_COUNT 256
+
+typedef struct {
+    int x, y;
+    size_t id;
+} GridEntry;
+
+struct UniformGrid
+{
+    Lt *lt;
+    float cell_size;
+    float margin;
+
+    // Entries as they were inserted
+    Dynarray *entries;
+
+    // Entries ordered by their bucket (counting sort)
+    GridEntry *sorted;
+    size_t sorted_capacity;
+
+    // Offsets of the buckets within `sorted`
+    size_t *buckets;
+    size_t buckets_count;
+};
+
+static size_t cell_hash(int x, int y)
+{
+    return ((size_t) (unsigned int) x * 73856093u) ^ ((size_t) (unsigned int) y * 19349663u);
+}
+
+static int cell_coord(const UniformGrid *grid, float a)
+{
+    return (int) floorf(a / grid->cell_size);
+}
+
+UniformGrid *create_uniform_grid(float cell_size, float margin)
+{
+    trace_assert(cell_size > 0.0f);
+    trace_assert(margin >= 0.0f);
+
+    Lt *lt = create_lt();
+
+    UniformGrid *grid = PUSH_LT(lt, nth_calloc(1, sizeof(UniformGrid)), free);
+    if (grid == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    grid->lt = lt;
+
+    grid->cell_size = cell_size;
+    grid->margin = margin;
+
+    grid->entries = PUSH_LT(lt, create_dynarray(sizeof(GridEntry)), destroy_dynarray);
+    if (grid->entries == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    grid->sorted_capacity = UNIFORM_GRID_INIT_BUCKETS_COUNT;
+    grid->sorted = PUSH_LT(lt, nth_calloc(grid->sorted_capacity, sizeof(GridEntry)), free);
+    if (grid->sorted == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    grid->buckets_count = UNIFORM_GRID_INIT_BUCKETS_COUNT;
+    grid->buckets = PUSH_LT(lt, nth_calloc(grid->buckets_count + 1, sizeof(size_t)), free);
+    if (grid->buckets == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    return grid;
+}
+
+void destroy_uniform_grid(UniformGrid *grid)
+{
+    trace_assert(grid);
+    RETURN_LT0(grid->lt);
+}
+
+void uniform_grid_clear(UniformGrid *grid)
+{
+    trace_assert(grid);
+    dynarray_clear(grid->entries);
+}
+
+int uniform_grid_insert(UniformGrid *grid, size_t id, Rect rect)
+{
+    trace_assert(grid);
+
+    rect = rect_scale(rect, grid->margin);
+
+    const int x1 = cell_coord(grid, rect.x);
+    const int y1 = cell_coord(grid, rect.y);
+    const int x2 = cell_coord(grid, rect.x + rect.w);
+    const int y2 = cell_coord(grid, rect.y + rect.h);
+
+    GridEntry entry = { .id = id };
+    for (entry.y = y1; entry.y <= y2; ++entry.y) {
+        for (entry.x = x1; entry.x <= x2; ++entry.x) {
+            if (dynarray_push(grid->entries, &entry) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int uniform_grid_reserve(UniformGrid *grid, size_t n)
+{
+    trace_assert(grid);
+
+    if (n > grid->sorted_capacity) {
+        size_t new_capacity = grid->sorted_capacity;
+        while (new_capacity < n) {
+            new_capacity *= 2;
+        }
+
+        GridEntry *new_sorted = nth_realloc(grid->sorted, new_capacity * sizeof(GridEntry));
+        if (new_sorted == NULL) {
+            return -1;
+        }
+        grid->sorted = REPLACE_LT(grid->lt, grid->sorted, new_sorted);
+        grid->sorted_capacity = new_capacity;
+    }
+
+    // Keeping the load factor of the buckets at most 1/2
+    if (n * 2 > grid->buckets_count) {
+        size_t new_count = grid->buckets_count;
+        while (n * 2 > new_count) {
+            new_count *= 2;
+        }
+
+        size_t *new_buckets = nth_realloc(grid->buckets, (new_count + 1) * sizeof(size_t));
+        if (new_buckets == NULL) {
+            return -1;
+        }
+        grid->buckets = REPLACE_LT(grid->lt, grid->buckets, new_buckets);
+        grid->buckets_count = new_count;
+    }
+
+    return 0;
+}
+
+int uniform_grid_pairs(UniformGrid *grid,
+                       const Rect *rects,
+                       Dynarray *pairs)
+{
+    trace_assert(grid);
+    trace_assert(rects);
+    trace_assert(pairs);
+
+    const size_t n = dynarray_count(grid->entries);
+    if (n == 0) {
+        return 0;
+    }
+
+    if (uniform_grid_reserve(grid, n) < 0) {
+        return -1;
+    }
+
+    const GridEntry *entries = dynarray_data(grid->entries);
+    const size_t mask = grid->buckets_count - 1;
+
+    memset(grid->buckets, 0, (grid->buckets_count + 1) * sizeof(size_t));
+    for (size_t i = 0; i < n; ++i) {
+        grid->buckets[(cell_hash(entries[i].x, entries[i].y) & mask) + 1]++;
+    }
+    for (size_t b = 1; b <= grid->buckets_count; ++b) {
+        grid->buckets[b] += grid->buckets[b - 1];
+    }
+    // After this loop buckets[b] points at the end of the bucket b
+    for (size_t i = 0; i < n; ++i) {
+        grid->sorted[grid->buckets[cell_hash(entries[i].x, entries[i].y) & mask]++] = entries[i];
+    }
+
+    size_t pair[2];
+    size_t begin = 0;
+    for (size_t b = 0; b < grid->buckets_count; ++b) {
+        const size_t end = grid->buckets[b];
+
+        for (size_t i = begin; i < end; ++i) {
+            const GridEntry a = grid->sorted[i];
+
+            for (size_t j = i + 1; j < end; ++j) {
+                const GridEntry c = grid->sorted[j];
+
+                if (a.x != c.x || a.y != c.y) {
+                    continue;
+                }
+
+                // Two bodies may share several cells. The pair is
+                // reported only by the cell that contains the top-left
+                // corner of their intersection.
+                const Rect ra = rect_scale(rects[a.id], grid->margin);
+                const Rect rc = rect_scale(rects[c.id], grid->margin);
+                if (cell_coord(grid, fmaxf(ra.x, rc.x)) != a.x ||
+                    cell_coord(grid, fmaxf(ra.y, rc.y)) != a.y) {
+                    continue;
+                }
+
+                pair[0] = a.id < c.id ? a.id : c.id;
+                pair[1] = a.id < c.id ? c.id : a.id;
+                if (dynarray_push(pairs, pair) < 0) {
+                    return -1;
+                }
+            }
+        }
+
+        begin = end;
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef UNIFORM_GRID_H_
+#define UNIFORM_GRID_H_
+
+#include "math/rect.h"
+
+typedef struct UniformGrid UniformGrid;
+typedef struct Dynarray Dynarray;
+
+// The rects are expanded by `margin` on every side, so the bodies
+// that barely touch each other are reported as well.
+UniformGrid *create_uniform_grid(float cell_size, float margin);
+void destroy_uniform_grid(UniformGrid *grid);
+
+void uniform_grid_clear(UniformGrid *grid);
+int uniform_grid_insert(UniformGrid *grid, size_t id, Rect rect);
+
+// Pushes every pair of ids that share at least one cell into `pairs`
+// (element type is `size_t[2]`). Each pair is reported exactly once.
+// `rects` is indexed by the ids that were inserted into the grid.
+int uniform_grid_pairs(UniformGrid *grid,
+                       const Rect *rects,
+                       Dynarray *pairs);
+
+#endif  // UNIFORM_GRID_H_
@@ -108,6 +108,10 @@ int level_picker_render(const LevelPicker *level_picker,
         return -1;
     }
 
+    if (camera_flush(camera) < 0) {
+        return -1;
+    }
+
     if (list_selector_render(level_picker->list_selector, renderer) < 0) {
         return -1;
     }
@@ -0,0 +1,410 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "system/log.h"
+#include "system/lt.h"
+#include "system/nth_alloc.h"
+#include "system/stacktrace.h"
+#include "system/lt_adapters.h"
+
+#include "./replay.h"
+
+#define REPLAY_MAGIC "NRPL"
+#define REPLAY_MAGIC_SIZE 4
+#define REPLAY_VERSION 2
+// Longer console lines and level paths are considered a broken file
+#define REPLAY_MAX_STRING_SIZE 4096
+
+struct ReplayWriter
+{
+    Lt *lt;
+    FILE *stream;
+    uint32_t tick;
+    // The tick of the previous record
+    uint32_t record_tick;
+    // Whether a move or a stop was recorded and which one was the last.
+    // The level holds it until the next one, so repeating it is not
+    // recorded no matter how many ticks later it comes.
+    bool has_move;
+    LevelAction move;
+};
+
+struct ReplayReader
+{
+    Lt *lt;
+    FILE *stream;
+    uint32_t seed;
+    float delta_time;
+    char *level_filename;
+    uint32_t tick;
+    char *line;
+};
+
+static int replay_write_u8(FILE *stream, uint8_t value)
+{
+    return fputc(value, stream) == EOF ? -1 : 0;
+}
+
+static int replay_write_varint(FILE *stream, uint64_t value)
+{
+    while (value >= 0x80) {
+        if (replay_write_u8(stream, (uint8_t) (value | 0x80)) < 0) {
+            return -1;
+        }
+        value >>= 7;
+    }
+    return replay_write_u8(stream, (uint8_t) value);
+}
+
+static int replay_write_fixed(FILE *stream, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (replay_write_u8(stream, (uint8_t) (value >> (8 * i))) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int replay_write_string(FILE *stream, const char *s)
+{
+    const size_t n = strlen(s);
+    if (n > REPLAY_MAX_STRING_SIZE) {
+        log_fail("Could not record a string of %zu bytes\n", n);
+        return -1;
+    }
+
+    if (replay_write_varint(stream, n) < 0
+        || fwrite(s, 1, n, stream) != n) {
+        return -1;
+    }
+    return 0;
+}
+
+static int replay_read_u8(FILE *stream, uint8_t *value)
+{
+    const int c = fgetc(stream);
+    if (c == EOF) {
+        return -1;
+    }
+    *value = (uint8_t) c;
+    return 0;
+}
+
+static int replay_read_varint(FILE *stream, uint64_t *value)
+{
+    *value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = 0;
+        if (replay_read_u8(stream, &byte) < 0) {
+            return -1;
+        }
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int replay_read_fixed(FILE *stream, uint64_t *value, size_t size)
+{
+    *value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t byte = 0;
+        if (replay_read_u8(stream, &byte) < 0) {
+            return -1;
+        }
+        *value |= (uint64_t) byte << (8 * i);
+    }
+    return 0;
+}
+
+static int replay_write_float(FILE *stream, float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return replay_write_fixed(stream, bits, sizeof(bits));
+}
+
+static int replay_read_float(FILE *stream, float *value)
+{
+    uint64_t bits = 0;
+    if (replay_read_fixed(stream, &bits, sizeof(uint32_t)) < 0) {
+        return -1;
+    }
+
+    const uint32_t bits32 = (uint32_t) bits;
+    memcpy(value, &bits32, sizeof(*value));
+    return 0;
+}
+
+// Reads a string into `buffer` of REPLAY_MAX_STRING_SIZE + 1 bytes
+static int replay_read_string(FILE *stream, char *buffer)
+{
+    uint64_t n = 0;
+    if (replay_read_varint(stream, &n) < 0 || n > REPLAY_MAX_STRING_SIZE) {
+        return -1;
+    }
+
+    if (fread(buffer, 1, (size_t) n, stream) != n) {
+        return -1;
+    }
+    buffer[n] = '\0';
+
+    return 0;
+}
+
+ReplayWriter *create_replay_writer(const char *replay_filename,
+                                   uint32_t seed,
+                                   float delta_time,
+                                   const char *level_filename)
+{
+    trace_assert(replay_filename);
+    trace_assert(delta_time > 0.0f);
+    trace_assert(level_filename);
+
+    Lt *lt = create_lt();
+
+    ReplayWriter *writer = PUSH_LT(lt, nth_calloc(1, sizeof(ReplayWriter)), free);
+    if (writer == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    writer->lt = lt;
+
+    writer->stream = PUSH_LT(lt, fopen(replay_filename, "wb"), fclose_lt);
+    if (writer->stream == NULL) {
+        log_fail("Could not open %s: %s\n", replay_filename, strerror(errno));
+        RETURN_LT(lt, NULL);
+    }
+
+    if (fwrite(REPLAY_MAGIC, 1, REPLAY_MAGIC_SIZE, writer->stream) != REPLAY_MAGIC_SIZE
+        || replay_write_u8(writer->stream, REPLAY_VERSION) < 0
+        || replay_write_fixed(writer->stream, seed, sizeof(seed)) < 0
+        || replay_write_float(writer->stream, delta_time) < 0
+        || replay_write_string(writer->stream, level_filename) < 0) {
+        log_fail("Could not write the header of %s\n", replay_filename);
+        RETURN_LT(lt, NULL);
+    }
+
+    return writer;
+}
+
+void destroy_replay_writer(ReplayWriter *writer)
+{
+    trace_assert(writer);
+    RETURN_LT0(writer->lt);
+}
+
+void replay_writer_tick(ReplayWriter *writer)
+{
+    trace_assert(writer);
+    writer->tick++;
+}
+
+static int replay_writer_begin_record(ReplayWriter *writer,
+                                      ReplayRecordKind kind)
+{
+    trace_assert(writer);
+
+    if (replay_write_varint(writer->stream, writer->tick - writer->record_tick) < 0
+        || replay_write_u8(writer->stream, (uint8_t) kind) < 0) {
+        log_fail("Could not write the replay\n");
+        return -1;
+    }
+    writer->record_tick = writer->tick;
+
+    return 0;
+}
+
+int replay_writer_action(ReplayWriter *writer, LevelAction action)
+{
+    trace_assert(writer);
+
+    const bool is_move = action != LEVEL_ACTION_JUMP;
+    if (is_move && writer->has_move && writer->move == action) {
+        return 0;
+    }
+
+    if (replay_writer_begin_record(writer, REPLAY_ACTION) < 0
+        || replay_write_u8(writer->stream, (uint8_t) action) < 0) {
+        return -1;
+    }
+
+    if (is_move) {
+        writer->has_move = true;
+        writer->move = action;
+    }
+
+    return 0;
+}
+
+int replay_writer_console(ReplayWriter *writer, const char *line)
+{
+    trace_assert(writer);
+    trace_assert(line);
+
+    if (replay_writer_begin_record(writer, REPLAY_CONSOLE) < 0
+        || replay_write_string(writer->stream, line) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int replay_writer_finish(ReplayWriter *writer, uint64_t checksum)
+{
+    trace_assert(writer);
+
+    if (replay_writer_begin_record(writer, REPLAY_END) < 0
+        || replay_write_fixed(writer->stream, checksum, sizeof(checksum)) < 0
+        || fflush(writer->stream) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+ReplayReader *create_replay_reader(const char *replay_filename)
+{
+    trace_assert(replay_filename);
+
+    Lt *lt = create_lt();
+
+    ReplayReader *reader = PUSH_LT(lt, nth_calloc(1, sizeof(ReplayReader)), free);
+    if (reader == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+    reader->lt = lt;
+
+    reader->stream = PUSH_LT(lt, fopen(replay_filename, "rb"), fclose_lt);
+    if (reader->stream == NULL) {
+        log_fail("Could not open %s: %s\n", replay_filename, strerror(errno));
+        RETURN_LT(lt, NULL);
+    }
+
+    reader->level_filename = PUSH_LT(
+        lt,
+        nth_calloc(REPLAY_MAX_STRING_SIZE + 1, sizeof(char)),
+        free);
+    if (reader->level_filename == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    reader->line = PUSH_LT(
+        lt,
+        nth_calloc(REPLAY_MAX_STRING_SIZE + 1, sizeof(char)),
+        free);
+    if (reader->line == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
+    char magic[REPLAY_MAGIC_SIZE];
+    uint8_t version = 0;
+    uint64_t seed = 0;
+    if (fread(magic, 1, REPLAY_MAGIC_SIZE, reader->stream) != REPLAY_MAGIC_SIZE
+        || memcmp(magic, REPLAY_MAGIC, REPLAY_MAGIC_SIZE) != 0) {
+        log_fail("%s is not a replay\n", replay_filename);
+        RETURN_LT(lt, NULL);
+    }
+
+    if (replay_read_u8(reader->stream, &version) < 0 || version != REPLAY_VERSION) {
+        log_fail("%s: unsupported replay version %u\n", replay_filename, version);
+        RETURN_LT(lt, NULL);
+    }
+
+    if (replay_read_fixed(reader->stream, &seed, sizeof(reader->seed)) < 0
+        || replay_read_float(reader->stream, &reader->delta_time) < 0
+        || !isfinite(reader->delta_time)
+        || reader->delta_time <= 0.0f
+        || replay_read_string(reader->stream, reader->level_filename) < 0) {
+        log_fail("%s: broken replay header\n", replay_filename);
+        RETURN_LT(lt, NULL);
+    }
+    reader->seed = (uint32_t) seed;
+
+    return reader;
+}
+
+void destroy_replay_reader(ReplayReader *reader)
+{
+    trace_assert(reader);
+    RETURN_LT0(reader->lt);
+}
+
+uint32_t replay_reader_seed(const ReplayReader *reader)
+{
+    trace_assert(reader);
+    return reader->seed;
+}
+
+float replay_reader_delta_time(const ReplayReader *reader)
+{
+    trace_assert(reader);
+    return reader->delta_time;
+}
+
+const char *replay_reader_level_filename(const ReplayReader *reader)
+{
+    trace_assert(reader);
+    return reader->level_filename;
+}
+
+int replay_reader_next(ReplayReader *reader, ReplayRecord *record)
+{
+    trace_assert(reader);
+    trace_assert(record);
+
+    uint64_t tick_delta = 0;
+    uint8_t kind = 0;
+    if (replay_read_varint(reader->stream, &tick_delta) < 0
+        || tick_delta > UINT32_MAX - reader->tick
+        || replay_read_u8(reader->stream, &kind) < 0) {
+        log_fail("The replay ends unexpectedly\n");
+        return -1;
+    }
+    reader->tick += (uint32_t) tick_delta;
+
+    memset(record, 0, sizeof(*record));
+    record->kind = (ReplayRecordKind) kind;
+    record->tick = reader->tick;
+
+    switch (record->kind) {
+    case REPLAY_ACTION: {
+        uint8_t action = 0;
+        if (replay_read_u8(reader->stream, &action) < 0
+            || action > LEVEL_ACTION_JUMP) {
+            log_fail("Broken action in the replay\n");
+            return -1;
+        }
+        record->action = (LevelAction) action;
+    } break;
+
+    case REPLAY_CONSOLE: {
+        if (replay_read_string(reader->stream, reader->line) < 0) {
+            log_fail("Broken console line in the replay\n");
+            return -1;
+        }
+        record->line = reader->line;
+    } break;
+
+    case REPLAY_END: {
+        if (replay_read_fixed(reader->stream, &record->checksum,
+                              sizeof(record->checksum)) < 0) {
+            log_fail("Broken end of the replay\n");
+            return -1;
+        }
+    } break;
+
+    default: {
+        log_fail("Unknown record %u in the replay\n", kind);
+        return -1;
+    }
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+
+#include "game/level.h"
+
+// A replay is everything that affects the simulation of a level: the
+// seed of rand() the level was loaded with, the time step of the
+// updates, the actions of the player and the lines evaluated in the
+// console, each stamped with the number of level updates done before
+// it. The file is
+//
+//   "NRPL" version:u8 seed:u32 delta-time:f32 level-file:string
+//   { tick-delta:varint kind:u8 [action:u8 | line:string] }
+//   tick-delta:varint REPLAY_END checksum:u64
+//
+// where string is length:varint followed by the bytes, f32 is the bits
+// of an IEEE 754 float and all of the fixed size values are
+// little-endian.
+
+typedef enum {
+    REPLAY_ACTION = 0,
+    REPLAY_CONSOLE,
+    REPLAY_END
+} ReplayRecordKind;
+
+typedef struct {
+    ReplayRecordKind kind;
+    uint32_t tick;
+    LevelAction action;
+    // Valid until the next replay_reader_next()
+    const char *line;
+    // Checksum of the level at the end of the recording, see
+    // level_checksum()
+    uint64_t checksum;
+} ReplayRecord;
+
+typedef struct ReplayWriter ReplayWriter;
+
+ReplayWriter *create_replay_writer(const char *replay_filename,
+                                   uint32_t seed,
+                                   float delta_time,
+                                   const char *level_filename);
+// Does not finish the replay. A replay without its end is rejected on
+// playback.
+void destroy_replay_writer(ReplayWriter *writer);
+
+// Marks one more update of the level
+void replay_writer_tick(ReplayWriter *writer);
+// A move or a stop equal to the last recorded one is skipped, see
+// level_act()
+int replay_writer_action(ReplayWriter *writer, LevelAction action);
+int replay_writer_console(ReplayWriter *writer, const char *line);
+int replay_writer_finish(ReplayWriter *writer, uint64_t checksum);
+
+typedef struct ReplayReader ReplayReader;
+
+ReplayReader *create_replay_reader(const char *replay_filename);
+void destroy_replay_reader(ReplayReader *reader);
+
+uint32_t replay_reader_seed(const ReplayReader *reader);
+float replay_reader_delta_time(const ReplayReader *reader);
+const char *replay_reader_level_filename(const ReplayReader *reader);
+
+// Reads the next record. Returns -1 if the file is broken or ends
+// before REPLAY_END.
+int replay_reader_next(ReplayReader *reader, ReplayRecord *record);
+
+#endif  // REPLAY_H_
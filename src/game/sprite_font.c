@@ -1,6 +1,8 @@
 #include <SDL.h>
 #include "system/stacktrace.h"
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "math/rect.h"
@@ -11,11 +13,41 @@
 #include "system/log.h"
 
 #define FONT_ROW_SIZE 18
+// How many laid out texts are kept around
+#define SPRITE_FONT_LAYOUTS_COUNT 64
+
+// Where the characters of a text go relative to the position of the
+// text and where they come from in the texture
+typedef struct {
+    char *text;
+    size_t length;
+    size_t capacity;
+    Vec size;
+    SDL_Rect *char_rects;
+    Rect *dest_rects;
+} Sprite_font_layout;
+
+// Everything that changes while rendering the text with the const
+// font
+typedef struct {
+    Sprite_font_layout layouts[SPRITE_FONT_LAYOUTS_COUNT];
+
+    SDL_Vertex *vertices;
+    int *indices;
+    size_t batch_capacity;
+
+    // Set when SDL_RenderGeometry() does not work and the characters
+    // are copied one by one
+    bool geometry_broken;
+} Sprite_font_cache;
 
 struct Sprite_font
 {
     Lt *lt;
     SDL_Texture *texture;
+    int texture_w;
+    int texture_h;
+    Sprite_font_cache *cache;
 };
 
 Sprite_font *create_sprite_font_from_file(const char *bmp_file_path,
@@ -56,6 +88,20 @@ Sprite_font *create_sprite_font_from_file(const char *bmp_file_path,
 
     SDL_FreeSurface(RELEASE_LT(lt, surface));
 
+    if (SDL_QueryTexture(
+            sprite_font->texture,
+            NULL, NULL,
+            &sprite_font->texture_w,
+            &sprite_font->texture_h) < 0) {
+        log_fail("SDL_QueryTexture: %s\n", SDL_GetError());
+        RETURN_LT(lt, NULL);
+    }
+
+    sprite_font->cache = PUSH_LT(lt, nth_calloc(1, sizeof(Sprite_font_cache)), free);
+    if (sprite_font->cache == NULL) {
+        RETURN_LT(lt, NULL);
+    }
+
     sprite_font->lt = lt;
 
     return sprite_font;
@@ -84,19 +130,231 @@ static SDL_Rect sprite_font_char_rect(const Sprite_font *sprite_font, char x)
     }
 }
 
-int sprite_font_render_text(const Sprite_font *sprite_font,
-                            SDL_Renderer *renderer,
-                            Vec position,
-                            Vec size,
-                            Color color,
-                            const char *text)
+// Reallocates `*array` of the font to `size` bytes
+static int sprite_font_reserve(const Sprite_font *sprite_font,
+                               void **array,
+                               size_t size)
+{
+    trace_assert(sprite_font);
+    trace_assert(array);
+
+    void *new_array = nth_realloc(*array, size);
+    if (new_array == NULL) {
+        return -1;
+    }
+
+    if (*array == NULL) {
+        *array = PUSH_LT(sprite_font->lt, new_array, free);
+    } else {
+        *array = REPLACE_LT(sprite_font->lt, *array, new_array);
+    }
+
+    return 0;
+}
+
+static size_t sprite_font_layout_index(const char *text, size_t length, Vec size)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t) text[i]) * 1099511628211ULL;
+    }
+
+    uint32_t bits[2];
+    memcpy(bits, &size, sizeof(bits));
+    hash = (hash ^ bits[0]) * 1099511628211ULL;
+    hash = (hash ^ bits[1]) * 1099511628211ULL;
+
+    return (size_t) (hash % SPRITE_FONT_LAYOUTS_COUNT);
+}
+
+// Lays out the text or returns the layout made earlier
+static const Sprite_font_layout *sprite_font_layout(const Sprite_font *sprite_font,
+                                                    const char *text,
+                                                    size_t length,
+                                                    Vec size)
+{
+    trace_assert(sprite_font);
+    trace_assert(text);
+
+    Sprite_font_layout *layout =
+        &sprite_font->cache->layouts[sprite_font_layout_index(text, length, size)];
+
+    if (layout->text != NULL
+        && layout->length == length
+        && layout->size.x == size.x
+        && layout->size.y == size.y
+        && memcmp(layout->text, text, length) == 0) {
+        return layout;
+    }
+
+    if (length + 1 > layout->capacity) {
+        if (sprite_font_reserve(sprite_font, (void **) &layout->text, length + 1) < 0
+            || sprite_font_reserve(sprite_font, (void **) &layout->char_rects, (length + 1) * sizeof(SDL_Rect)) < 0
+            || sprite_font_reserve(sprite_font, (void **) &layout->dest_rects, (length + 1) * sizeof(Rect)) < 0) {
+            // The layout might be half reallocated
+            layout->length = 0;
+            return NULL;
+        }
+        layout->capacity = length + 1;
+    }
+
+    memcpy(layout->text, text, length);
+    layout->text[length] = '\0';
+    layout->length = length;
+    layout->size = size;
+
+    for (size_t i = 0; i < length; ++i) {
+        const SDL_Rect char_rect = sprite_font_char_rect(sprite_font, text[i]);
+        layout->char_rects[i] = char_rect;
+        layout->dest_rects[i] = rect(
+            (float) FONT_CHAR_WIDTH * (float) i * size.x,
+            0.0f,
+            (float) char_rect.w * size.x,
+            (float) char_rect.h * size.y);
+    }
+
+    return layout;
+}
+
+static SDL_Rect sprite_font_dest_rect(const Sprite_font_layout *layout,
+                                      size_t i,
+                                      Vec position,
+                                      const Vec *offsets)
+{
+    trace_assert(layout);
+    trace_assert(i < layout->length);
+
+    const Vec offset = offsets ? offsets[i] : vec(0.0f, 0.0f);
+    const Rect dest = layout->dest_rects[i];
+
+    return rect_for_sdl(
+        rect(position.x + offset.x + dest.x,
+             position.y + offset.y + dest.y,
+             dest.w, dest.h));
+}
+
+// Submits the whole layout as a single geometry batch
+static int sprite_font_render_geometry(const Sprite_font *sprite_font,
+                                       SDL_Renderer *renderer,
+                                       const Sprite_font_layout *layout,
+                                       Vec position,
+                                       SDL_Color color,
+                                       const Vec *offsets)
+{
+    trace_assert(sprite_font);
+    trace_assert(renderer);
+    trace_assert(layout);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    Sprite_font_cache *cache = sprite_font->cache;
+
+    if (cache->geometry_broken) {
+        return -1;
+    }
+
+    if (layout->length > cache->batch_capacity) {
+        if (sprite_font_reserve(sprite_font, (void **) &cache->vertices, layout->length * 4 * sizeof(SDL_Vertex)) < 0
+            || sprite_font_reserve(sprite_font, (void **) &cache->indices, layout->length * 6 * sizeof(int)) < 0) {
+            cache->batch_capacity = 0;
+            return -1;
+        }
+
+        for (size_t i = 0; i < layout->length; ++i) {
+            const int first = (int) i * 4;
+            cache->indices[i * 6 + 0] = first + 0;
+            cache->indices[i * 6 + 1] = first + 1;
+            cache->indices[i * 6 + 2] = first + 2;
+            cache->indices[i * 6 + 3] = first + 2;
+            cache->indices[i * 6 + 4] = first + 3;
+            cache->indices[i * 6 + 5] = first + 0;
+        }
+        cache->batch_capacity = layout->length;
+    }
+
+    const float tw = (float) sprite_font->texture_w;
+    const float th = (float) sprite_font->texture_h;
+
+    for (size_t i = 0; i < layout->length; ++i) {
+        const SDL_Rect src = layout->char_rects[i];
+        const SDL_Rect dest = sprite_font_dest_rect(layout, i, position, offsets);
+        SDL_Vertex *quad = cache->vertices + i * 4;
+
+        quad[0].position.x = (float) dest.x;
+        quad[0].position.y = (float) dest.y;
+        quad[0].tex_coord.x = (float) src.x / tw;
+        quad[0].tex_coord.y = (float) src.y / th;
+
+        quad[1].position.x = (float) (dest.x + dest.w);
+        quad[1].position.y = (float) dest.y;
+        quad[1].tex_coord.x = (float) (src.x + src.w) / tw;
+        quad[1].tex_coord.y = (float) src.y / th;
+
+        quad[2].position.x = (float) (dest.x + dest.w);
+        quad[2].position.y = (float) (dest.y + dest.h);
+        quad[2].tex_coord.x = (float) (src.x + src.w) / tw;
+        quad[2].tex_coord.y = (float) (src.y + src.h) / th;
+
+        quad[3].position.x = (float) dest.x;
+        quad[3].position.y = (float) (dest.y + dest.h);
+        quad[3].tex_coord.x = (float) src.x / tw;
+        quad[3].tex_coord.y = (float) (src.y + src.h) / th;
+
+        for (size_t j = 0; j < 4; ++j) {
+            quad[j].color = color;
+        }
+    }
+
+    if (SDL_RenderGeometry(
+            renderer,
+            sprite_font->texture,
+            cache->vertices, (int) layout->length * 4,
+            cache->indices, (int) layout->length * 6) < 0) {
+        log_warn("SDL_RenderGeometry: %s. Copying the characters one by one\n",
+                 SDL_GetError());
+        cache->geometry_broken = true;
+        return -1;
+    }
+
+    return 0;
+#else
+    (void) position;
+    (void) color;
+    (void) offsets;
+    return -1;
+#endif
+}
+
+int sprite_font_render_text_with_offsets(const Sprite_font *sprite_font,
+                                         SDL_Renderer *renderer,
+                                         Vec position,
+                                         Vec size,
+                                         Color color,
+                                         const char *text,
+                                         const Vec *offsets)
 {
     trace_assert(sprite_font);
     trace_assert(renderer);
     trace_assert(text);
 
+    const size_t text_size = strlen(text);
+    if (text_size == 0) {
+        return 0;
+    }
+
+    const Sprite_font_layout *layout = sprite_font_layout(sprite_font, text, text_size, size);
+    if (layout == NULL) {
+        return -1;
+    }
+
     const SDL_Color sdl_color = color_for_sdl(color);
 
+    if (sprite_font_render_geometry(
+            sprite_font, renderer, layout,
+            position, sdl_color, offsets) == 0) {
+        return 0;
+    }
+
     if (SDL_SetTextureColorMod(sprite_font->texture, sdl_color.r, sdl_color.g, sdl_color.b) < 0) {
         log_fail("SDL_SetTextureColorMod: %s\n", SDL_GetError());
         return -1;
@@ -107,16 +365,9 @@ int sprite_font_render_text(const Sprite_font *sprite_font,
         return -1;
     }
 
-    const size_t text_size = strlen(text);
-    for (size_t i = 0; i < text_size; ++i) {
-        const SDL_Rect char_rect = sprite_font_char_rect(sprite_font, text[i]);
-        const SDL_Rect dest_rect = rect_for_sdl(
-            rect(
-                position.x + (float) FONT_CHAR_WIDTH * (float) i * size.x,
-                position.y,
-                (float) char_rect.w * size.x,
-                (float) char_rect.h * size.y));
-        if (SDL_RenderCopy(renderer, sprite_font->texture, &char_rect, &dest_rect) < 0) {
+    for (size_t i = 0; i < layout->length; ++i) {
+        const SDL_Rect dest_rect = sprite_font_dest_rect(layout, i, position, offsets);
+        if (SDL_RenderCopy(renderer, sprite_font->texture, &layout->char_rects[i], &dest_rect) < 0) {
             return -1;
         }
     }
@@ -124,6 +375,17 @@ int sprite_font_render_text(const Sprite_font *sprite_font,
     return 0;
 }
 
+int sprite_font_render_text(const Sprite_font *sprite_font,
+                            SDL_Renderer *renderer,
+                            Vec position,
+                            Vec size,
+                            Color color,
+                            const char *text)
+{
+    return sprite_font_render_text_with_offsets(
+        sprite_font, renderer, position, size, color, text, NULL);
+}
+
 Rect sprite_font_boundary_box(const Sprite_font *sprite_font,
                                 Vec position,
                                 Vec size,
@@ -14,12 +14,23 @@ Sprite_font *create_sprite_font_from_file(const char *bmp_file_path,
                                             SDL_Renderer *renderer);
 void destroy_sprite_font(Sprite_font *sprite_font);
 
+// The layouts of the recently rendered texts are kept, and each text
+// is drawn with a single SDL_RenderGeometry() when it's available
 int sprite_font_render_text(const Sprite_font *sprite_font,
                             SDL_Renderer *renderer,
                             Vec position,
                             Vec size,
                             Color color,
                             const char *text);
+// Renders the i-th character of the text moved by offsets[i].
+// `offsets` may be NULL.
+int sprite_font_render_text_with_offsets(const Sprite_font *sprite_font,
+                                         SDL_Renderer *renderer,
+                                         Vec position,
+                                         Vec size,
+                                         Color color,
+                                         const char *text,
+                                         const Vec *offsets);
 
 Rect sprite_font_boundary_box(const Sprite_font *sprite_font,
                               Vec position,
@@ -19,9 +19,87 @@
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 
+// The physics never catches up more than that many steps per frame.
+// Otherwise a slow frame makes the next one even slower.
+#define MAX_PHYSICS_STEPS_PER_FRAME 5
+
 static void print_usage(FILE *stream)
 {
-    fprintf(stream, "Usage: nothing [--fps <fps>]\n");
+    fprintf(stream, "Usage: nothing [--fps <fps>] [--physics-hz <hz>] [--physics-threads <threads>] [--record <replay-file>] [--headless <level-file> [--ticks <ticks>]] [--replay <replay-file>]\n");
+}
+
+static int parse_positive_int_flag(int argc, char *argv[], int i,
+                                   const char *name, int *value)
+{
+    if (i + 1 >= argc) {
+        log_fail("Value of %s is not provided\n", name);
+        return -1;
+    }
+
+    if (sscanf(argv[i + 1], "%d", value) != 1 || *value <= 0) {
+        log_fail("Cannot parse %s: %s is not a positive number\n", name, argv[i + 1]);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Updates the level as fast as possible without any window, renderer
+// or sound and reports how many updates per second it managed. With a
+// replay the level and the input come from the replay and it runs
+// until the replay ends.
+static int run_headless(const char *level_filename, const char *replay_filename,
+                        int ticks, float delta_time, size_t physics_threads)
+{
+    Lt *lt = create_lt();
+
+    if (SDL_Init(SDL_INIT_TIMER) < 0) {
+        log_fail("Could not initialize SDL: %s\n", SDL_GetError());
+        RETURN_LT(lt, -1);
+    }
+    PUSH_LT(lt, 42, SDL_Quit);
+
+    Game *const game = PUSH_LT(
+        lt,
+        create_game("./levels/", NULL, 0, NULL),
+        destroy_game);
+    if (game == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    if (game_set_physics_threads(game, physics_threads) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
+    if (replay_filename != NULL) {
+        if (game_play_replay(game, replay_filename, &delta_time) < 0) {
+            log_fail("Could not play replay %s\n", replay_filename);
+            RETURN_LT(lt, -1);
+        }
+    } else if (game_load_level(game, level_filename) < 0) {
+        log_fail("Could not load level %s\n", level_filename);
+        RETURN_LT(lt, -1);
+    }
+
+    const Uint64 begin_counter = SDL_GetPerformanceCounter();
+
+    int tick = 0;
+    while ((replay_filename != NULL || tick < ticks) && !game_over_check(game)) {
+        if (game_update(game, delta_time) < 0) {
+            RETURN_LT(lt, -1);
+        }
+        tick++;
+    }
+
+    const float elapsed =
+        (float) (SDL_GetPerformanceCounter() - begin_counter)
+        / (float) SDL_GetPerformanceFrequency();
+
+    printf("ticks: %d\n", tick);
+    printf("seconds: %f\n", elapsed);
+    printf("ticks/sec: %f\n", elapsed > 0.0f ? (float) tick / elapsed : 0.0f);
+
+    RETURN_LT(lt, 0);
 }
 
 int main(int argc, char *argv[])
@@ -30,22 +108,65 @@ int main(int argc, char *argv[])
 
     Lt *lt = create_lt();
 
-    int fps = 30;
+    // 0 means the frames are paced only by the vsync
+    int fps = 0;
+    int physics_hz = 60;
+    // 0 means all of the bodies are solved together on the main thread
+    int physics_threads = 0;
+    const char *headless_level = NULL;
+    const char *record_replay = NULL;
+    const char *play_replay = NULL;
+    int ticks = 1000;
 
     for (int i = 1; i < argc;) {
         if (strcmp(argv[i], "--fps") == 0) {
-            if (i + 1 < argc) {
-                if (sscanf(argv[i + 1], "%d", &fps) == 0) {
-                    log_fail("Cannot parse FPS: %s is not a number\n", argv[i + 1]);
-                    print_usage(stderr);
-                    RETURN_LT(lt, -1);
-                }
-                i += 2;
-            } else {
-                log_fail("Value of FPS is not provided\n");
+            if (parse_positive_int_flag(argc, argv, i, "FPS", &fps) < 0) {
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "--physics-hz") == 0) {
+            if (parse_positive_int_flag(argc, argv, i, "physics rate", &physics_hz) < 0) {
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "--physics-threads") == 0) {
+            if (parse_positive_int_flag(argc, argv, i, "physics threads", &physics_threads) < 0) {
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            if (i + 1 >= argc) {
+                log_fail("Level file of --headless is not provided\n");
                 print_usage(stderr);
                 RETURN_LT(lt, -1);
             }
+            headless_level = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--record") == 0) {
+            if (i + 1 >= argc) {
+                log_fail("Replay file of --record is not provided\n");
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            record_replay = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            if (i + 1 >= argc) {
+                log_fail("Replay file of --replay is not provided\n");
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            play_replay = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--ticks") == 0) {
+            if (parse_positive_int_flag(argc, argv, i, "ticks", &ticks) < 0) {
+                print_usage(stderr);
+                RETURN_LT(lt, -1);
+            }
+            i += 2;
         } else {
             log_fail("Unknown flag %s\n", argv[i]);
             print_usage(stderr);
@@ -53,6 +174,12 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (headless_level != NULL || play_replay != NULL) {
+        RETURN_LT(lt, run_headless(headless_level, play_replay, ticks,
+                                   1.0f / (float) physics_hz,
+                                   (size_t) physics_threads));
+    }
+
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
         log_fail("Could not initialize SDL: %s\n", SDL_GetError());
         RETURN_LT(lt, -1);
@@ -129,14 +256,38 @@ int main(int argc, char *argv[])
         RETURN_LT(lt, -1);
     }
 
+    if (game_set_physics_threads(game, (size_t) physics_threads) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
     const Uint8 *const keyboard_state = SDL_GetKeyboardState(NULL);
 
     SDL_StopTextInput();
     SDL_Event e;
-    const int64_t delta_time = (int64_t) roundf(1000.0f / 60.0f);
-    int64_t render_timer = (int64_t) roundf(1000.0f / (float) fps);
+
+    // The simulation always advances by delta_time. The time that is
+    // not enough for a whole step is carried over to the next frame
+    // and is used to interpolate the rendered frame between the last
+    // two steps.
+    const float delta_time = 1.0f / (float) physics_hz;
+
+    if (record_replay != NULL && game_record_replay(game, record_replay, delta_time) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
+    const float max_frame_time = delta_time * MAX_PHYSICS_STEPS_PER_FRAME;
+    const float min_frame_time = fps > 0 ? 1.0f / (float) fps : 0.0f;
+    const float counter_frequency = (float) SDL_GetPerformanceFrequency();
+
+    float accumulator = 0.0f;
+    Uint64 prev_frame_counter = SDL_GetPerformanceCounter();
+
     while (!game_over_check(game)) {
-        const int64_t begin_frame_time = (int64_t) SDL_GetTicks();
+        const Uint64 frame_counter = SDL_GetPerformanceCounter();
+        const float frame_time = (float) (frame_counter - prev_frame_counter) / counter_frequency;
+        prev_frame_counter = frame_counter;
+
+        accumulator += frame_time < max_frame_time ? frame_time : max_frame_time;
 
         while (!game_over_check(game) && SDL_PollEvent(&e)) {
             if (game_event(game, &e) < 0) {
@@ -148,25 +299,26 @@ int main(int argc, char *argv[])
             RETURN_LT(lt, -1);
         }
 
-        if (game_update(game, (float) delta_time * 0.001f) < 0) {
-            RETURN_LT(lt, -1);
+        while (accumulator >= delta_time) {
+            if (game_update(game, delta_time) < 0) {
+                RETURN_LT(lt, -1);
+            }
+            accumulator -= delta_time;
         }
 
         if (game_sound(game) < 0) {
             RETURN_LT(lt, -1);
         }
 
-        render_timer -= delta_time;
-        if (render_timer <= 0) {
-            if (game_render(game) < 0) {
-                RETURN_LT(lt, -1);
-            }
-            SDL_RenderPresent(renderer);
-            render_timer = (int64_t) roundf(1000.0f / (float) fps);
+        if (game_render(game, accumulator / delta_time) < 0) {
+            RETURN_LT(lt, -1);
         }
+        SDL_RenderPresent(renderer);
 
-        const int64_t end_frame_time = (int64_t) SDL_GetTicks();
-        SDL_Delay((unsigned int) max_int64(10, delta_time - (end_frame_time - begin_frame_time)));
+        const float elapsed = (float) (SDL_GetPerformanceCounter() - frame_counter) / counter_frequency;
+        if (elapsed < min_frame_time) {
+            SDL_Delay((Uint32) ((min_frame_time - elapsed) * 1000.0f));
+        }
     }
 
     RETURN_LT(lt, 0);
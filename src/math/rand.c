@@ -11,3 +11,25 @@ float rand_float_range(float lower, float upper)
 {
     return rand_float(upper - lower) + lower;
 }
+
+LocalRand local_rand(uint64_t seed)
+{
+    const LocalRand result = { .state = seed };
+    return result;
+}
+
+// SplitMix64
+uint32_t local_rand_next(LocalRand *local)
+{
+    uint64_t z = (local->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+float local_rand_float_range(LocalRand *local, float lower, float upper)
+{
+    // 24 bits fit into the mantissa of a float
+    const float t = (float) (local_rand_next(local) >> 8) / (float) (1u << 24);
+    return lower + t * (upper - lower);
+}
@@ -1,7 +1,20 @@
 #ifndef RAND_H_
 #define RAND_H_
 
+#include <stdint.h>
+
 float rand_float(float max_value);
 float rand_float_range(float lower, float upper);
 
+// A generator with its own state for the things that must look
+// random but always the same. Unlike srand() it does not disturb the
+// sequence of rand() that the rest of the game relies on.
+typedef struct {
+    uint64_t state;
+} LocalRand;
+
+LocalRand local_rand(uint64_t seed);
+uint32_t local_rand_next(LocalRand *local);
+float local_rand_float_range(LocalRand *local, float lower, float upper);
+
 #endif  // RAND_H_
@@ -2,9 +2,17 @@
 #include "nth_alloc.h"
 #include "log.h"
 
+static size_t allocations_count = 0;
+
+size_t nth_alloc_count(void)
+{
+    return allocations_count;
+}
+
 void *nth_calloc(size_t num, size_t size)
 {
     void *mem = calloc(num, size);
+    allocations_count++;
 
     if (mem == NULL) {
         log_fail("nth_calloc(%lu, %lu) failed", num, size);
@@ -16,6 +24,7 @@ void *nth_calloc(size_t num, size_t size)
 void *nth_realloc(void *ptr, size_t new_size)
 {
     void *mem = realloc(ptr, new_size);
+    allocations_count++;
 
     if (mem == NULL) {
         log_fail("nth_realloc(0x%x, %lu) failed", ptr, new_size);
@@ -4,4 +4,7 @@
 void *nth_calloc(size_t num, size_t size);
 void *nth_realloc(void *ptr, size_t new_size);
 
+// How many times nth_calloc and nth_realloc were called so far
+size_t nth_alloc_count(void);
+
 #endif  // NTH_ALLOC_H_
@@ -124,9 +124,16 @@ void destroy_console(Console *console)
     RETURN_LT0(console->lt);
 }
 
-static int console_eval_input(Console *console)
+const char *console_input(const Console *console)
+{
+    trace_assert(console);
+    return edit_field_as_text(console->edit_field);
+}
+
+int console_eval(Console *console, const char *source_code)
 {
-    const char *source_code = edit_field_as_text(console->edit_field);
+    trace_assert(console);
+    trace_assert(source_code);
 
     /* TODO(#387): console pushes empty strings to the history */
     if (history_push(console->history, source_code) < 0) {
@@ -146,8 +153,6 @@ static int console_eval_input(Console *console)
                 return -1;
             }
 
-            edit_field_clean(console->edit_field);
-
             return 0;
         }
 
@@ -175,6 +180,16 @@ static int console_eval_input(Console *console)
     }
 
     gc_collect(console->gc, console->scope.expr);
+
+    return 0;
+}
+
+static int console_eval_input(Console *console)
+{
+    if (console_eval(console, edit_field_as_text(console->edit_field)) < 0) {
+        return -1;
+    }
+
     edit_field_clean(console->edit_field);
 
     return 0;
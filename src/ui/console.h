@@ -15,6 +15,12 @@ void destroy_console(Console *console);
 int console_handle_event(Console *console,
                          const SDL_Event *event);
 
+// The line that is being typed in
+const char *console_input(const Console *console);
+// Evaluates `source_code` as if it was typed in. Works without a font,
+// the log is just never rendered then.
+int console_eval(Console *console, const char *source_code);
+
 int console_render(const Console *console,
                    Camera *camera,
                    SDL_Renderer *renderer);
@@ -9,6 +9,9 @@
 #include "system/str.h"
 #include "game/camera.h"
 
+// The text is rendered in chunks of that many characters
+#define WIGGLY_TEXT_CHUNK_SIZE 64
+
 int wiggly_text_render(const WigglyText *wiggly_text,
                        Camera *camera,
                        Vec position)
@@ -17,21 +20,29 @@ int wiggly_text_render(const WigglyText *wiggly_text,
     trace_assert(camera);
 
     const size_t n = strlen(wiggly_text->text);
-    char buf[2] = {0, 0};
+    char buf[WIGGLY_TEXT_CHUNK_SIZE + 1];
+    Vec offsets[WIGGLY_TEXT_CHUNK_SIZE];
+
+    for (size_t begin = 0; begin < n; begin += WIGGLY_TEXT_CHUNK_SIZE) {
+        const size_t count = n - begin < WIGGLY_TEXT_CHUNK_SIZE ? n - begin : WIGGLY_TEXT_CHUNK_SIZE;
 
-    for (size_t i = 0; i < n; ++i) {
-        buf[0] = wiggly_text->text[i];
+        memcpy(buf, wiggly_text->text + begin, count);
+        buf[count] = '\0';
+
+        for (size_t j = 0; j < count; ++j) {
+            const size_t i = begin + j;
+            offsets[j] = vec(0.0f, sinf(wiggly_text->angle + (float) i / (float) n * 10.0f) * 20.0f);
+        }
 
-        if (camera_render_text_screen(
+        if (camera_render_text_screen_with_offsets(
                 camera,
                 buf,
                 wiggly_text->scale,
                 wiggly_text->color,
                 vec_sum(
                     position,
-                    vec(
-                        (float) (i * FONT_CHAR_WIDTH) * wiggly_text->scale.x,
-                        sinf(wiggly_text->angle + (float) i / (float) n * 10.0f) * 20.0f))) < 0) {
+                    vec((float) (begin * FONT_CHAR_WIDTH) * wiggly_text->scale.x, 0.0f)),
+                offsets) < 0) {
             return -1;
         }
     }
@@ -3,6 +3,8 @@
 #include "parser_suite.h"
 #include "interpreter_suite.h"
 #include "scope_suite.h"
+#include "rigid_bodies_suite.h"
+#include "replay_suite.h"
 
 TEST_MAIN()
 {
@@ -10,6 +12,8 @@ TEST_MAIN()
     TEST_RUN(parser_suite);
     TEST_RUN(interpreter_suite);
     TEST_RUN(scope_suite);
+    TEST_RUN(rigid_bodies_suite);
+    TEST_RUN(replay_suite);
 
     return 0;
 }
@@ -0,0 +1,274 @@
+#ifndef REPLAY_SUITE_H_
+#define REPLAY_SUITE_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "game/replay.h"
+
+#define REPLAY_SUITE_FILE "replay_suite.nrpl"
+
+// Writes `size` raw bytes to REPLAY_SUITE_FILE
+static int write_replay_bytes(const char *bytes, size_t size)
+{
+    FILE *stream = fopen(REPLAY_SUITE_FILE, "wb");
+    if (stream == NULL) {
+        return -1;
+    }
+
+    const size_t n = fwrite(bytes, 1, size, stream);
+    fclose(stream);
+
+    return n == size ? 0 : -1;
+}
+
+TEST(replay_round_trip_test)
+{
+    // As long as a line may be. Its length takes 2 bytes as a varint.
+    static char long_line[4097];
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+
+    ReplayWriter *writer = create_replay_writer(
+        REPLAY_SUITE_FILE, 0xdeadbeef, 1.0f / 120.0f, "./levels/level-01.txt");
+    ASSERT_TRUE(writer != NULL, {
+        fprintf(stderr, "Could not create the replay\n");
+    });
+
+    replay_writer_tick(writer);
+    ASSERT_TRUE(replay_writer_action(writer, LEVEL_ACTION_MOVE_LEFT) == 0, {
+        fprintf(stderr, "Could not record an action\n");
+        destroy_replay_writer(writer);
+    });
+
+    // The tick delta takes 3 bytes
+    for (size_t i = 0; i < 20000; ++i) {
+        replay_writer_tick(writer);
+    }
+    ASSERT_TRUE(replay_writer_console(writer, long_line) == 0, {
+        fprintf(stderr, "Could not record a console line\n");
+        destroy_replay_writer(writer);
+    });
+    ASSERT_TRUE(replay_writer_console(writer, "") == 0, {
+        fprintf(stderr, "Could not record an empty console line\n");
+        destroy_replay_writer(writer);
+    });
+
+    replay_writer_tick(writer);
+    ASSERT_TRUE(replay_writer_finish(writer, 0x0123456789abcdefULL) == 0, {
+        fprintf(stderr, "Could not finish the replay\n");
+        destroy_replay_writer(writer);
+    });
+    destroy_replay_writer(writer);
+
+    ReplayReader *reader = create_replay_reader(REPLAY_SUITE_FILE);
+    ASSERT_TRUE(reader != NULL, {
+        fprintf(stderr, "Could not read the replay back\n");
+    });
+
+    ASSERT_TRUE(replay_reader_seed(reader) == 0xdeadbeef, {
+        fprintf(stderr, "Unexpected seed %x\n", replay_reader_seed(reader));
+        destroy_replay_reader(reader);
+    });
+    ASSERT_TRUE(replay_reader_delta_time(reader) == 1.0f / 120.0f, {
+        fprintf(stderr, "Unexpected time step %f\n", (double) replay_reader_delta_time(reader));
+        destroy_replay_reader(reader);
+    });
+    ASSERT_TRUE(strcmp(replay_reader_level_filename(reader), "./levels/level-01.txt") == 0, {
+        fprintf(stderr, "Unexpected level %s\n", replay_reader_level_filename(reader));
+        destroy_replay_reader(reader);
+    });
+
+    ReplayRecord record;
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_ACTION
+                && record.tick == 1
+                && record.action == LEVEL_ACTION_MOVE_LEFT, {
+        fprintf(stderr, "Unexpected action record\n");
+        destroy_replay_reader(reader);
+    });
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_CONSOLE
+                && record.tick == 20001
+                && strcmp(record.line, long_line) == 0, {
+        fprintf(stderr, "Unexpected long console record\n");
+        destroy_replay_reader(reader);
+    });
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_CONSOLE
+                && record.tick == 20001
+                && strcmp(record.line, "") == 0, {
+        fprintf(stderr, "Unexpected empty console record\n");
+        destroy_replay_reader(reader);
+    });
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_END
+                && record.tick == 20002
+                && record.checksum == 0x0123456789abcdefULL, {
+        fprintf(stderr, "Unexpected end record\n");
+        destroy_replay_reader(reader);
+    });
+
+    destroy_replay_reader(reader);
+    remove(REPLAY_SUITE_FILE);
+
+    return 0;
+}
+
+TEST(replay_held_move_test)
+{
+    ReplayWriter *writer = create_replay_writer(
+        REPLAY_SUITE_FILE, 1, 1.0f / 60.0f, "./levels/level-01.txt");
+    ASSERT_TRUE(writer != NULL, {
+        fprintf(stderr, "Could not create the replay\n");
+    });
+
+    // Holding the direction reports it on every tick, like level_input()
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(replay_writer_action(writer, LEVEL_ACTION_MOVE_RIGHT) == 0, {
+            fprintf(stderr, "Could not record an action\n");
+            destroy_replay_writer(writer);
+        });
+        replay_writer_tick(writer);
+    }
+
+    ASSERT_TRUE(replay_writer_finish(writer, 0) == 0, {
+        fprintf(stderr, "Could not finish the replay\n");
+        destroy_replay_writer(writer);
+    });
+    destroy_replay_writer(writer);
+
+    ReplayReader *reader = create_replay_reader(REPLAY_SUITE_FILE);
+    ASSERT_TRUE(reader != NULL, {
+        fprintf(stderr, "Could not read the replay back\n");
+    });
+
+    ReplayRecord record;
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_ACTION
+                && record.tick == 0
+                && record.action == LEVEL_ACTION_MOVE_RIGHT, {
+        fprintf(stderr, "Unexpected action record\n");
+        destroy_replay_reader(reader);
+    });
+
+    ASSERT_TRUE(replay_reader_next(reader, &record) == 0
+                && record.kind == REPLAY_END
+                && record.tick == 100, {
+        fprintf(stderr, "The held move was recorded more than once\n");
+        destroy_replay_reader(reader);
+    });
+
+    destroy_replay_reader(reader);
+    remove(REPLAY_SUITE_FILE);
+
+    return 0;
+}
+
+TEST(replay_broken_header_test)
+{
+    // The bytes of the time step are 1/60 as a little-endian float
+#define REPLAY_SUITE_HEADER "NRPL\x02" "\x01\x00\x00\x00" "\x89\x88\x88\x3c"
+
+    const struct {
+        const char *name;
+        const char *bytes;
+        size_t size;
+    } broken[] = {
+        {"empty", "", 0},
+        {"wrong magic", "NRPX\x02", 5},
+        {"wrong version", "NRPL\x01", 5},
+        {"truncated seed", "NRPL\x02\x01\x00", 7},
+        {"zero time step", "NRPL\x02" "\x01\x00\x00\x00" "\x00\x00\x00\x00" "\x00", 14},
+        {"NaN time step", "NRPL\x02" "\x01\x00\x00\x00" "\x00\x00\xc0\x7f" "\x00", 14},
+        {"truncated level", REPLAY_SUITE_HEADER "\x05" "ab", 16},
+        {"level too long", REPLAY_SUITE_HEADER "\x81\x20", 15},
+        {"varint too long", REPLAY_SUITE_HEADER
+         "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 24}
+    };
+
+#undef REPLAY_SUITE_HEADER
+
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); ++i) {
+        ASSERT_TRUE(write_replay_bytes(broken[i].bytes, broken[i].size) == 0, {
+            fprintf(stderr, "Could not write %s\n", REPLAY_SUITE_FILE);
+        });
+
+        ReplayReader *reader = create_replay_reader(REPLAY_SUITE_FILE);
+        ASSERT_TRUE(reader == NULL, {
+            fprintf(stderr, "Replay with %s was accepted\n", broken[i].name);
+            destroy_replay_reader(reader);
+        });
+    }
+
+    remove(REPLAY_SUITE_FILE);
+
+    return 0;
+}
+
+TEST(replay_broken_records_test)
+{
+#define REPLAY_SUITE_HEADER "NRPL\x02" "\x01\x00\x00\x00" "\x89\x88\x88\x3c" "\x01" "a"
+
+    const struct {
+        const char *name;
+        const char *bytes;
+        size_t size;
+    } broken[] = {
+        {"no end", REPLAY_SUITE_HEADER, 15},
+        {"unknown record", REPLAY_SUITE_HEADER "\x00\x07", 17},
+        {"unknown action", REPLAY_SUITE_HEADER "\x00\x00\x7f", 18},
+        {"truncated line", REPLAY_SUITE_HEADER "\x00\x01\x03" "ab", 20},
+        {"truncated checksum", REPLAY_SUITE_HEADER "\x00\x02\x01\x02", 19},
+        {"tick overflow", REPLAY_SUITE_HEADER "\xff\xff\xff\xff\x7f\x00\x00", 22}
+    };
+
+#undef REPLAY_SUITE_HEADER
+
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); ++i) {
+        ASSERT_TRUE(write_replay_bytes(broken[i].bytes, broken[i].size) == 0, {
+            fprintf(stderr, "Could not write %s\n", REPLAY_SUITE_FILE);
+        });
+
+        ReplayReader *reader = create_replay_reader(REPLAY_SUITE_FILE);
+        ASSERT_TRUE(reader != NULL, {
+            fprintf(stderr, "Header of the replay with %s was rejected\n", broken[i].name);
+        });
+
+        ReplayRecord record;
+        int result = 0;
+        while (result == 0) {
+            result = replay_reader_next(reader, &record);
+            if (result == 0 && record.kind == REPLAY_END) {
+                break;
+            }
+        }
+        destroy_replay_reader(reader);
+
+        ASSERT_TRUE(result < 0, {
+            fprintf(stderr, "Replay with %s was accepted\n", broken[i].name);
+        });
+    }
+
+    remove(REPLAY_SUITE_FILE);
+
+    return 0;
+}
+
+TEST_SUITE(replay_suite)
+{
+    TEST_RUN(replay_round_trip_test);
+    TEST_RUN(replay_held_move_test);
+    TEST_RUN(replay_broken_header_test);
+    TEST_RUN(replay_broken_records_test);
+
+    return 0;
+}
+
+#endif  // REPLAY_SUITE_H_
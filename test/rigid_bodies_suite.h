@@ -0,0 +1,389 @@
+#ifndef RIGID_BODIES_SUITE_H_
+#define RIGID_BODIES_SUITE_H_
+
+#include <inttypes.h>
+
+#include "test.h"
+#include "dynarray.h"
+#include "game/camera.h"
+#include "game/level/platforms.h"
+#include "game/level/rigid_bodies.h"
+#include "game/level/rigid_bodies/pair_table.h"
+#include "game/level/level_editor/rect_layer.h"
+#include "system/line_stream.h"
+#include "system/lt.h"
+
+#define RIGID_BODIES_SUITE_TICKS 120
+
+// Loads the floor all of the bodies are dropped on. Everything it
+// creates is owned by `lt`.
+static Platforms *load_floor_platforms(Lt *lt)
+{
+    LineStream *line_stream = PUSH_LT(
+        lt,
+        create_line_stream("test-data/rigid-bodies-floor.txt", "r", 256),
+        destroy_line_stream);
+    if (line_stream == NULL) {
+        return NULL;
+    }
+
+    RectLayer *floor_layer = PUSH_LT(
+        lt,
+        create_rect_layer_from_line_stream(line_stream),
+        destroy_rect_layer);
+    if (floor_layer == NULL) {
+        return NULL;
+    }
+
+    return PUSH_LT(
+        lt,
+        create_platforms_from_rect_layer(floor_layer),
+        destroy_platforms);
+}
+
+// The same steps as level_update() does for the bodies
+static int step_rigid_bodies(RigidBodies *rigid_bodies,
+                             const Platforms *platforms,
+                             size_t ticks)
+{
+    for (size_t tick = 0; tick < ticks; ++tick) {
+        rigid_bodies_apply_omniforce(rigid_bodies, vec(0.0f, 1500.0f));
+        rigid_bodies_integrate_all(rigid_bodies, 1.0f / 60.0f);
+        if (rigid_bodies_collide(rigid_bodies, platforms) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Drops columns of overlapping boxes on a floor and returns the
+// checksum of where they ended up
+static int simulate_rigid_bodies(BroadphaseType broadphase,
+                                 size_t threads_count,
+                                 uint64_t *checksum)
+{
+    Lt *lt = create_lt();
+
+    Platforms *platforms = load_floor_platforms(lt);
+    if (platforms == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    RigidBodies *rigid_bodies = PUSH_LT(
+        lt,
+        create_rigid_bodies(256, broadphase),
+        destroy_rigid_bodies);
+    if (rigid_bodies == NULL) {
+        RETURN_LT(lt, -1);
+    }
+
+    if (rigid_bodies_set_island_threads(rigid_bodies, threads_count) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
+    for (size_t column = 0; column < 8; ++column) {
+        for (size_t row = 0; row < 10; ++row) {
+            const Rect body = rect(
+                (float) column * 70.0f + (float) (row % 3) * 7.0f,
+                -60.0f - (float) row * 45.0f,
+                50.0f, 50.0f);
+            if (rigid_bodies_add(rigid_bodies, body) == RIGID_BODIES_NO_ID) {
+                RETURN_LT(lt, -1);
+            }
+        }
+    }
+
+    if (step_rigid_bodies(rigid_bodies, platforms, RIGID_BODIES_SUITE_TICKS) < 0) {
+        RETURN_LT(lt, -1);
+    }
+
+    *checksum = rigid_bodies_checksum(rigid_bodies);
+
+    RETURN_LT(lt, 0);
+}
+
+TEST(rigid_bodies_threads_count_test)
+{
+    const BroadphaseType broadphases[] = {
+        BROADPHASE_ALL_PAIRS,
+        BROADPHASE_UNIFORM_GRID,
+        BROADPHASE_SWEEP_AND_PRUNE
+    };
+    const size_t threads_counts[] = {1, 2, 4};
+
+    for (size_t i = 0; i < sizeof(broadphases) / sizeof(broadphases[0]); ++i) {
+        // 0 threads is the default solver without the thread pool
+        uint64_t expected = 0;
+        ASSERT_TRUE(simulate_rigid_bodies(broadphases[i], 0, &expected) == 0, {
+            fprintf(stderr, "Could not simulate the bodies\n");
+        });
+
+        for (size_t j = 0; j < sizeof(threads_counts) / sizeof(threads_counts[0]); ++j) {
+            uint64_t actual = 0;
+            ASSERT_TRUE(simulate_rigid_bodies(broadphases[i], threads_counts[j], &actual) == 0, {
+                fprintf(stderr, "Could not simulate the bodies\n");
+            });
+            ASSERT_TRUE(expected == actual, {
+                fprintf(stderr,
+                        "Broadphase %d with %zu threads: expected checksum %" PRIx64 ", got %" PRIx64 "\n",
+                        (int) broadphases[i], threads_counts[j], expected, actual);
+            });
+        }
+    }
+
+    return 0;
+}
+
+TEST(rigid_bodies_sleep_test)
+{
+    Lt *lt = create_lt();
+
+    Platforms *platforms = load_floor_platforms(lt);
+    ASSERT_TRUE(platforms != NULL, {
+        fprintf(stderr, "Could not load the floor\n");
+        RETURN_LT(lt, -1);
+    });
+
+    RigidBodies *rigid_bodies = PUSH_LT(
+        lt,
+        create_rigid_bodies(16, BROADPHASE_UNIFORM_GRID),
+        destroy_rigid_bodies);
+    ASSERT_TRUE(rigid_bodies != NULL, {
+        fprintf(stderr, "Could not create the bodies\n");
+        RETURN_LT(lt, -1);
+    });
+
+    const RigidBodyId bottom = rigid_bodies_add(rigid_bodies, rect(0.0f, -50.0f, 50.0f, 50.0f));
+    ASSERT_TRUE(bottom != RIGID_BODIES_NO_ID
+                && step_rigid_bodies(rigid_bodies, platforms, RIGID_BODIES_SUITE_TICKS) == 0
+                && rigid_bodies_asleep(rigid_bodies, bottom), {
+        fprintf(stderr, "The body at rest did not fall asleep\n");
+        RETURN_LT(lt, -1);
+    });
+
+    // A sleeping body is not pulled by the omniforce
+    const Rect asleep_hitbox = rigid_bodies_hitbox(rigid_bodies, bottom);
+    ASSERT_TRUE(step_rigid_bodies(rigid_bodies, platforms, RIGID_BODIES_SUITE_TICKS) == 0
+                && rigid_bodies_asleep(rigid_bodies, bottom)
+                && rigid_bodies_hitbox(rigid_bodies, bottom).y == asleep_hitbox.y, {
+        fprintf(stderr, "The sleeping body moved\n");
+        RETURN_LT(lt, -1);
+    });
+
+    rigid_bodies_apply_force(rigid_bodies, bottom, vec(0.0f, -20000.0f));
+    ASSERT_TRUE(!rigid_bodies_asleep(rigid_bodies, bottom), {
+        fprintf(stderr, "A force did not wake the body up\n");
+        RETURN_LT(lt, -1);
+    });
+
+    ASSERT_TRUE(step_rigid_bodies(rigid_bodies, platforms, 1) == 0
+                && rigid_bodies_hitbox(rigid_bodies, bottom).y < asleep_hitbox.y, {
+        fprintf(stderr, "The woken up body did not move\n");
+        RETURN_LT(lt, -1);
+    });
+
+    ASSERT_TRUE(step_rigid_bodies(rigid_bodies, platforms, RIGID_BODIES_SUITE_TICKS * 2) == 0
+                && rigid_bodies_asleep(rigid_bodies, bottom), {
+        fprintf(stderr, "The body did not fall asleep again\n");
+        RETURN_LT(lt, -1);
+    });
+
+    // A body dropped on the sleeping one wakes it up
+    const RigidBodyId top = rigid_bodies_add(rigid_bodies, rect(10.0f, -300.0f, 50.0f, 50.0f));
+    ASSERT_TRUE(top != RIGID_BODIES_NO_ID, {
+        fprintf(stderr, "Could not add the body\n");
+        RETURN_LT(lt, -1);
+    });
+
+    bool woken = false;
+    for (size_t tick = 0; tick < RIGID_BODIES_SUITE_TICKS && !woken; ++tick) {
+        ASSERT_TRUE(step_rigid_bodies(rigid_bodies, platforms, 1) == 0, {
+            fprintf(stderr, "Could not simulate the bodies\n");
+            RETURN_LT(lt, -1);
+        });
+        woken = !rigid_bodies_asleep(rigid_bodies, bottom);
+    }
+    ASSERT_TRUE(woken, {
+        fprintf(stderr, "The falling body did not wake the sleeping one up\n");
+        RETURN_LT(lt, -1);
+    });
+
+    RETURN_LT(lt, 0);
+}
+
+TEST(pair_table_test)
+{
+    // 64 slots, which hold up to 32 pairs before the table grows
+    PairTable *table = create_pair_table(1);
+    ASSERT_TRUE(table != NULL, {
+        fprintf(stderr, "Could not create the table\n");
+    });
+
+    // The second half of the pairs are the first half reversed
+    const size_t pairs_count = 200;
+    for (size_t round = 0; round < 3; ++round) {
+        for (size_t i = 0; i < pairs_count; ++i) {
+            const size_t i1 = i < pairs_count / 2 ? i : i - pairs_count / 2 + 1000;
+            const size_t i2 = i < pairs_count / 2 ? i + 1000 : i - pairs_count / 2;
+
+            size_t index = 0;
+            ASSERT_TRUE(pair_table_insert(table, i1, i2, &index) == 0 && index == i, {
+                fprintf(stderr, "Pair %zu got the index %zu\n", i, index);
+                destroy_pair_table(table);
+            });
+
+            // Every pair inserted so far survives the collisions of the
+            // full table and its growth
+            for (size_t j = 0; j <= i; ++j) {
+                const size_t j1 = j < pairs_count / 2 ? j : j - pairs_count / 2 + 1000;
+                const size_t j2 = j < pairs_count / 2 ? j + 1000 : j - pairs_count / 2;
+                size_t at1 = 0, at2 = 0;
+                pair_table_at(table, j, &at1, &at2);
+
+                ASSERT_TRUE(pair_table_find(table, j1, j2, &index)
+                            && index == j && at1 == j1 && at2 == j2, {
+                    fprintf(stderr, "Lost pair %zu after inserting %zu pairs\n", j, i + 1);
+                    destroy_pair_table(table);
+                });
+            }
+        }
+
+        size_t index = 0;
+        ASSERT_TRUE(pair_table_insert(table, 0, 1000, &index) == 0
+                    && index == 0
+                    && pair_table_count(table) == pairs_count, {
+            fprintf(stderr, "A pair was inserted twice\n");
+            destroy_pair_table(table);
+        });
+
+        pair_table_clear(table);
+        ASSERT_TRUE(pair_table_count(table) == 0
+                    && !pair_table_find(table, 0, 1000, NULL)
+                    && !pair_table_find(table, 1000, 0, NULL), {
+            fprintf(stderr, "The pairs outlived the clear\n");
+            destroy_pair_table(table);
+        });
+    }
+
+    destroy_pair_table(table);
+
+    return 0;
+}
+
+TEST(dynarray_pop_test)
+{
+    Dynarray *dynarray = create_dynarray(sizeof(size_t));
+    ASSERT_TRUE(dynarray != NULL, {
+        fprintf(stderr, "Could not create the array\n");
+    });
+
+    // Well past the initial capacity
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(dynarray_push(dynarray, &i) == 0, {
+            fprintf(stderr, "Could not push %zu\n", i);
+            destroy_dynarray(dynarray);
+        });
+    }
+
+    dynarray_pop(dynarray, NULL);
+    for (size_t i = 99; i > 0; --i) {
+        size_t element = 0;
+        dynarray_pop(dynarray, &element);
+        ASSERT_TRUE(element == i - 1 && dynarray_count(dynarray) == i - 1, {
+            fprintf(stderr, "Popped %zu instead of %zu\n", element, i - 1);
+            destroy_dynarray(dynarray);
+        });
+    }
+
+    destroy_dynarray(dynarray);
+
+    return 0;
+}
+
+TEST(rigid_bodies_grow_test)
+{
+    RigidBodies *rigid_bodies = create_rigid_bodies(4, BROADPHASE_SWEEP_AND_PRUNE);
+    ASSERT_TRUE(rigid_bodies != NULL, {
+        fprintf(stderr, "Could not create the bodies\n");
+    });
+
+    RigidBodyId ids[100];
+    for (size_t i = 0; i < 100; ++i) {
+        ids[i] = rigid_bodies_add(rigid_bodies, rect((float) i * 100.0f, 0.0f, 50.0f, 50.0f));
+        ASSERT_TRUE(ids[i] != RIGID_BODIES_NO_ID, {
+            fprintf(stderr, "Could not add body %zu past the initial capacity\n", i);
+            destroy_rigid_bodies(rigid_bodies);
+        });
+    }
+
+    // The ids given out before the growth still point at their bodies
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(rigid_bodies_exists(rigid_bodies, ids[i])
+                    && rigid_bodies_hitbox(rigid_bodies, ids[i]).x == (float) i * 100.0f, {
+            fprintf(stderr, "Body %zu was lost by the growth\n", i);
+            destroy_rigid_bodies(rigid_bodies);
+        });
+    }
+
+    destroy_rigid_bodies(rigid_bodies);
+
+    return 0;
+}
+
+TEST(rigid_bodies_stale_id_test)
+{
+    RigidBodies *rigid_bodies = create_rigid_bodies(4, BROADPHASE_UNIFORM_GRID);
+    ASSERT_TRUE(rigid_bodies != NULL, {
+        fprintf(stderr, "Could not create the bodies\n");
+    });
+
+    const RigidBodyId first = rigid_bodies_add(rigid_bodies, rect(0.0f, 0.0f, 50.0f, 50.0f));
+    const RigidBodyId second = rigid_bodies_add(rigid_bodies, rect(100.0f, 0.0f, 50.0f, 50.0f));
+    const RigidBodyId last = rigid_bodies_add(rigid_bodies, rect(200.0f, 0.0f, 50.0f, 50.0f));
+
+    // The last body takes the slot of the removed one
+    rigid_bodies_remove(rigid_bodies, first);
+    const RigidBodyId reused = rigid_bodies_add(rigid_bodies, rect(300.0f, 0.0f, 50.0f, 50.0f));
+
+    ASSERT_TRUE(!rigid_bodies_exists(rigid_bodies, first)
+                && rigid_bodies_exists(rigid_bodies, second)
+                && rigid_bodies_exists(rigid_bodies, last)
+                && rigid_bodies_exists(rigid_bodies, reused)
+                && reused != first, {
+        fprintf(stderr, "The removed id is still alive\n");
+        destroy_rigid_bodies(rigid_bodies);
+    });
+
+    // The stale id does not reach any of the bodies that moved into
+    // its slot or reused its handle
+    rigid_bodies_apply_force(rigid_bodies, first, vec(100000.0f, 0.0f));
+    rigid_bodies_move(rigid_bodies, first, vec(100000.0f, 0.0f));
+    rigid_bodies_teleport_to(rigid_bodies, first, vec(-1000.0f, -1000.0f));
+    rigid_bodies_integrate_all(rigid_bodies, 1.0f / 60.0f);
+
+    ASSERT_TRUE(rigid_bodies_hitbox(rigid_bodies, second).x == 100.0f
+                && rigid_bodies_hitbox(rigid_bodies, last).x == 200.0f
+                && rigid_bodies_hitbox(rigid_bodies, reused).x == 300.0f, {
+        fprintf(stderr, "The stale id touched a live body\n");
+        destroy_rigid_bodies(rigid_bodies);
+    });
+
+    destroy_rigid_bodies(rigid_bodies);
+
+    return 0;
+}
+
+TEST_SUITE(rigid_bodies_suite)
+{
+    TEST_RUN(rigid_bodies_threads_count_test);
+    TEST_RUN(rigid_bodies_sleep_test);
+    TEST_RUN(pair_table_test);
+    TEST_RUN(dynarray_pop_test);
+    TEST_RUN(rigid_bodies_grow_test);
+    TEST_RUN(rigid_bodies_stale_id_test);
+
+    return 0;
+}
+
+#endif  // RIGID_BODIES_SUITE_H_